@@ -1,4 +1,4 @@
-QT += core gui widgets printsupport network
+QT += core gui widgets printsupport network concurrent
 
 CONFIG += c++17
 
@@ -49,6 +49,7 @@ RESOURCES += \
 HEADERS += \
     src/AdjustmentWindow.h \
     src/AppSettings.h \
+    src/BatchCalc.h \
     src/CalcManager.h \
     src/CalculatorWindow.h \
     src/CustomElemsManager.h \
@@ -78,6 +79,7 @@ HEADERS += \
     src/core/ElementFormula.h \
     src/core/Elements.h \
     src/core/ElementsCatalog.h \
+    src/core/Expression.h \
     src/core/Format.h \
     src/core/Formula.h \
     src/core/LuaHelper.h \
@@ -92,6 +94,7 @@ HEADERS += \
     src/core/Variable.h \
     src/funcs/BeamParamsAtElemsFunction.h \
     src/funcs/CausticFunction.h \
+    src/funcs/EvalContext.h \
     src/funcs/FormatInfo.h \
     src/funcs/FunctionBase.h \
     src/funcs/FunctionGraph.h \
@@ -101,9 +104,12 @@ HEADERS += \
     src/funcs/InfoFunctions.h \
     src/funcs/MultibeamCausticFunction.h \
     src/funcs/MultirangeCausticFunction.h \
+    src/funcs/OpticalProgram.h \
     src/funcs/PlotFuncRoundTripFunction.h \
     src/funcs/PlotFunction.h \
     src/funcs/PumpCalculator.h \
+    src/funcs/ResultCache.h \
+    src/funcs/RootFinder.h \
     src/funcs/RoundTripCalculator.h \
     src/funcs/StabilityMap2DFunction.h \
     src/funcs/StabilityMapFunction.h \
@@ -171,6 +177,7 @@ HEADERS += \
 SOURCES += \
     src/AdjustmentWindow.cpp \
     src/AppSettings.cpp \
+    src/BatchCalc.cpp \
     src/CalcManager.cpp \
     src/CalculatorWindow.cpp \
     src/CustomElemsManager.cpp \
@@ -200,6 +207,7 @@ SOURCES += \
     src/core/ElementFormula.cpp \
     src/core/Elements.cpp \
     src/core/ElementsCatalog.cpp \
+    src/core/Expression.cpp \
     src/core/Format.cpp \
     src/core/Formula.cpp \
     src/core/LuaHelper.cpp \
@@ -214,6 +222,7 @@ SOURCES += \
     src/core/Variable.cpp \
     src/funcs/BeamParamsAtElemsFunction.cpp \
     src/funcs/CausticFunction.cpp \
+    src/funcs/EvalContext.cpp \
     src/funcs/FormatInfo.cpp \
     src/funcs/FunctionBase.cpp \
     src/funcs/FunctionGraph.cpp \
@@ -223,9 +232,12 @@ SOURCES += \
     src/funcs/InfoFunctions.cpp \
     src/funcs/MultibeamCausticFunction.cpp \
     src/funcs/MultirangeCausticFunction.cpp \
+    src/funcs/OpticalProgram.cpp \
     src/funcs/PlotFuncRoundTripFunction.cpp \
     src/funcs/PlotFunction.cpp \
     src/funcs/PumpCalculator.cpp \
+    src/funcs/ResultCache.cpp \
+    src/funcs/RootFinder.cpp \
     src/funcs/RoundTripCalculator.cpp \
     src/funcs/StabilityMap2DFunction.cpp \
     src/funcs/StabilityMapFunction.cpp \
@@ -247,12 +259,15 @@ SOURCES += \
     src/io/SchemaWriterJson.cpp \
     src/main.cpp \
     src/tests/test_AbcdBeamCalculator.cpp \
+    src/tests/test_BatchCalc.cpp \
     src/tests/test_ElemSelectorWidget.cpp \
     src/tests/test_Element.cpp \
     src/tests/test_ElementFilter.cpp \
     src/tests/test_ElementFormula.cpp \
     src/tests/test_Elements.cpp \
     src/tests/test_ElementsImages.cpp \
+    src/tests/test_Expression.cpp \
+    src/tests/test_FunctionUtils.cpp \
     src/tests/test_GrinCalculator.cpp \
     src/tests/test_InfoFunctions.cpp \
     src/tests/test_LuaHelper.cpp \
@@ -263,6 +278,8 @@ SOURCES += \
     src/tests/test_PlotFunctions.cpp \
     src/tests/test_ProjectOperations.cpp \
     src/tests/test_Report.cpp \
+    src/tests/test_ResultCache.cpp \
+    src/tests/test_RootFinder.cpp \
     src/tests/test_RoundTripCalculator.cpp \
     src/tests/test_Schema.cpp \
     src/tests/test_SchemaReaderIni.cpp \
@@ -63,6 +63,8 @@ void AppSettings::load()
     LOAD_DEF(showCustomElemLibrary, Bool, true);
     LOAD_DEF(showPythonMatrices, Bool, false);
     LOAD_DEF(skipFuncWindowsLoading, Bool, false);
+    LOAD_DEF(calcThreadCount, Int, 0);
+    LOAD_DEF(resultCacheSizeMb, Int, 64);
 
     s.beginGroup("Debug");
     LOAD_DEF(showProtocolAtStart, Bool, false);
@@ -117,6 +119,8 @@ void AppSettings::save()
     SAVE(showCustomElemLibrary);
     SAVE(showPythonMatrices);
     SAVE(skipFuncWindowsLoading);
+    SAVE(calcThreadCount);
+    SAVE(resultCacheSizeMb);
 
     s.beginGroup("Debug");
     SAVE(showProtocolAtStart);
@@ -52,6 +52,8 @@ public:
     bool showCustomElemLibrary;  ///< Load Custom Element Library into Elements Catalog.
     bool showPythonMatrices;     ///< Show Python code for matrices in info function windows.
     bool skipFuncWindowsLoading; ///< Don't load function windows when opening schema.
+    int calcThreadCount = 0;     ///< Number of threads used by parallel calculations (0 - use all CPU cores).
+    int resultCacheSizeMb = 64;  ///< Memory for caching of function results, MB (0 - caching is disabled).
 
     bool layoutExportTransparent; ///< Use transparent background in exported images of layout.
 
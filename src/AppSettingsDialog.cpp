@@ -75,7 +75,24 @@ QWidget* AppSettingsDialog::createGeneralPage()
         tr("Don't load function windows when opening schema"),
     });
 
-    page->add({_groupOptions, page->stretch()});
+    _calcThreadCount = new QSpinBox;
+    _calcThreadCount->setRange(0, 256);
+    _calcThreadCount->setSpecialValueText(tr("Auto"));
+    _resultCacheSizeMb = new QSpinBox;
+    _resultCacheSizeMb->setRange(0, 1024);
+    _resultCacheSizeMb->setSuffix(tr(" MB"));
+    _resultCacheSizeMb->setSpecialValueText(tr("Disabled"));
+    auto groupCalc = new QGroupBox(tr("Calculations"));
+    LayoutV({
+        LayoutH({
+            new QLabel(tr("Number of threads (Auto - use all CPU cores)")), _calcThreadCount
+        }),
+        LayoutH({
+            new QLabel(tr("Memory for cached results")), _resultCacheSizeMb
+        }),
+    }).useFor(groupCalc);
+
+    page->add({_groupOptions, groupCalc, page->stretch()});
     return page;
 }
 
@@ -188,6 +205,8 @@ void AppSettingsDialog::populate()
     _groupOptions->setOption(6, settings.showCustomElemLibrary);
     _groupOptions->setOption(7, settings.showPythonMatrices);
     _groupOptions->setOption(8, settings.skipFuncWindowsLoading);
+    _calcThreadCount->setValue(settings.calcThreadCount);
+    _resultCacheSizeMb->setValue(settings.resultCacheSizeMb);
 
     // view
     _groupView->setOption(0, settings.smallToolbarImages);
@@ -226,6 +245,8 @@ bool AppSettingsDialog::collect()
     settings.showCustomElemLibrary = _groupOptions->option(6);
     settings.showPythonMatrices = _groupOptions->option(7);
     settings.skipFuncWindowsLoading = _groupOptions->option(8);
+    settings.calcThreadCount = _calcThreadCount->value();
+    settings.resultCacheSizeMb = _resultCacheSizeMb->value();
 
     // view
     settings.smallToolbarImages = _groupView->option(0);
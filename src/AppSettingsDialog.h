@@ -37,6 +37,8 @@ private:
     UnitComboBox *_defaultUnitAngle;
     QSpinBox *_exportNumberPrecision;
     QSpinBox *_numberPrecisionData;
+    QSpinBox *_calcThreadCount;
+    QSpinBox *_resultCacheSizeMb;
 
     QWidget* createGeneralPage();
     QWidget* createViewPage();
@@ -0,0 +1,265 @@
+#include "BatchCalc.h"
+
+#include "AppSettings.h"
+#include "core/Protocol.h"
+#include "core/Schema.h"
+#include "funcs/BeamVariationFunction.h"
+#include "funcs/CausticFunction.h"
+#include "funcs/MultibeamCausticFunction.h"
+#include "funcs/MultirangeCausticFunction.h"
+#include "funcs/StabilityMapFunction.h"
+#include "funcs/StabilityMap2DFunction.h"
+#include "io/SchemaReaderJson.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+QString num(double v)
+{
+    return QString::number(v, 'g', 15);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+//                               BatchCalc
+//------------------------------------------------------------------------------
+
+PlotFunction* BatchCalc::makeFunction(const QString& alias, Schema* schema)
+{
+    if (alias == StabilityMapFunction::_alias_()) return new StabilityMapFunction(schema);
+    if (alias == StabilityMap2DFunction::_alias_()) return new StabilityMap2DFunction(schema);
+    if (alias == CausticFunction::_alias_()) return new CausticFunction(schema);
+    // Windows stored in old files have type `Multicaustic`
+    if (alias == MultirangeCausticFunction::_alias_() || alias == QLatin1String("Multicaustic"))
+        return new MultirangeCausticFunction(schema);
+    if (alias == MultibeamCausticFunction::_alias_()) return new MultibeamCausticFunction(schema);
+    if (alias == BeamVariationFunction::_alias_()) return new BeamVariationFunction(schema);
+    return nullptr;
+}
+
+void BatchCalc::calcStoredFunctions(const QJsonObject& root)
+{
+    auto windowsJson = root["windows"].toArray();
+    int funcCount = 0;
+    for (int i = 0; i < windowsJson.size(); i++)
+    {
+        auto windowJson = windowsJson.at(i).toObject();
+        auto type = windowJson["type"].toString();
+
+        // There are windows of other kinds stored in the file, e.g. memos or element formulas
+        std::unique_ptr<PlotFunction> func(makeFunction(type, _schema));
+        if (!func) continue;
+
+        auto res = Z::IO::Json::readFunction(windowJson["function"].toObject(), func.get(), _schema);
+        if (!res.isEmpty())
+        {
+            _report.warning(QString("Unable to load function of window #%1 (%2): %3").arg(i).arg(type, res));
+            continue;
+        }
+        calcFunction(func.get(), QString("%1 (window #%2)").arg(func->name()).arg(i));
+        funcCount++;
+    }
+    if (funcCount == 0)
+        _report.warning("There are no functions stored in the file that can be calculated");
+}
+
+void BatchCalc::calcFunction(const QString& alias, const QJsonObject& args, const QString& title)
+{
+    std::unique_ptr<PlotFunction> func(makeFunction(alias, _schema));
+    if (!func)
+        return _report.error(QString("Unknown function '%1'").arg(alias));
+
+    auto res = Z::IO::Json::readFunction(args, func.get(), _schema);
+    if (!res.isEmpty())
+        return _report.error(QString("Invalid arguments of function '%1': %2").arg(alias, res));
+
+    calcFunction(func.get(), title.isEmpty() ? func->name() : title);
+}
+
+void BatchCalc::calcFunction(PlotFunction* func, const QString& title)
+{
+    // Each pump gives its own beam, the same as in the function window
+    auto multibeam = dynamic_cast<MultibeamCausticFunction*>(func);
+    if (multibeam)
+    {
+        if (!_schema->isSP())
+            return _report.warning(QString("%1: Function can only operate on SP schema").arg(title));
+        multibeam->calculatePumps(*_schema->pumps());
+        for (auto pump : *_schema->pumps())
+        {
+            multibeam->selectPump(pump);
+            writeResults(func, QString("%1, pump %2").arg(title, pump->label()));
+        }
+        return;
+    }
+
+    func->calculate();
+    writeResults(func, title);
+}
+
+void BatchCalc::writeResults(PlotFunction* func, const QString& title)
+{
+    if (!func->ok())
+        return _report.warning(QString("%1: %2").arg(title, func->errorText()));
+
+    QTextStream& out = *_out;
+    out << "# " << title << '\n';
+
+    auto stabMap2D = dynamic_cast<StabilityMap2DFunction*>(func);
+    if (stabMap2D)
+    {
+        out << "x\ty\tT\tS\n";
+        auto rangeX = stabMap2D->rangeX();
+        auto rangeY = stabMap2D->rangeY();
+        auto valuesX = rangeX.values();
+        auto valuesY = rangeY.values();
+        const auto& resultsT = stabMap2D->resultsT();
+        const auto& resultsS = stabMap2D->resultsS();
+        for (int ix = 0; ix < valuesX.size(); ix++)
+            for (int iy = 0; iy < valuesY.size(); iy++)
+            {
+                int index = ix * valuesY.size() + iy;
+                out << num(rangeX.unit()->toSi(valuesX.at(ix))) << '\t'
+                    << num(rangeY.unit()->toSi(valuesY.at(iy))) << '\t'
+                    << num(resultsT.at(index)) << '\t'
+                    << num(resultsS.at(index)) << '\n';
+            }
+        out << '\n';
+        return;
+    }
+
+    // Ranges of multirange caustic go one after another, as they are plotted
+    QList<PlotFunction*> funcs;
+    auto multirange = dynamic_cast<MultirangeCausticFunction*>(func);
+    if (multirange)
+        for (auto f : multirange->funcs())
+            funcs << f;
+    else
+        funcs << func;
+
+    out << "plane\tsegment\tx\ty\n";
+    for (auto plane : { Z::Plane_T, Z::Plane_S })
+    {
+        auto planeStr = plane == Z::Plane_T ? "T" : "S";
+        double offset = 0;
+        int segment = 0;
+        for (auto f : funcs)
+        {
+            for (int i = 0; i < f->resultCount(plane); i++, segment++)
+            {
+                const auto& result = f->result(plane, i);
+                for (int j = 0; j < result.pointsCount(); j++)
+                    out << planeStr << '\t' << segment << '\t'
+                        << num(result.x().at(j) + offset) << '\t'
+                        << num(result.y().at(j)) << '\n';
+            }
+            if (multirange)
+                offset += f->arg()->range.stop.toSi();
+        }
+    }
+    out << '\n';
+}
+
+bool BatchCalc::isRequested(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--calc") == 0)
+            return true;
+    return false;
+}
+
+int BatchCalc::run(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Calculates functions of schema file without GUI.");
+    auto optionHelp = parser.addHelpOption();
+    QCommandLineOption optionCalc("calc", "Run calculation without GUI.");
+    QCommandLineOption optionFunc("func", "Calculate a function instead of ones stored in the file: "
+        "StabMap, StabMap2D, Caustic, MultirangeCaustic, MultibeamCaustic, BeamVariation.", "alias");
+    QCommandLineOption optionArgs("args", "Function arguments in JSON format, "
+        "the same as function windows store them in schema file.", "json");
+    QCommandLineOption optionOutput("output", "Write results to the file instead of stdout.", "file");
+    parser.addOptions({optionCalc, optionFunc, optionArgs, optionOutput});
+    parser.addPositionalArgument("file", "Schema file (*.rez).");
+
+    if (!parser.parse(arguments))
+    {
+        std::cerr << qPrintable(parser.errorText()) << std::endl;
+        return 1;
+    }
+    if (parser.isSet(optionHelp))
+        parser.showHelp();
+
+    auto files = parser.positionalArguments();
+    if (files.size() != 1)
+    {
+        std::cerr << "Exactly one schema file is expected" << std::endl;
+        return 1;
+    }
+
+    // Settings affect calculations (e.g. the number of threads), but function windows are not needed
+    AppSettings::instance().load();
+    AppSettings::instance().skipFuncWindowsLoading = true;
+    Z::Protocol::isEnabled = false;
+
+    QFile file(files.first());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        std::cerr << "Unable to open file for reading: " << qPrintable(file.errorString()) << std::endl;
+        return 1;
+    }
+    auto data = file.readAll();
+    file.close();
+
+    Schema schema;
+    schema.events().disable();
+    SchemaReaderJson reader(&schema);
+    reader.readFromUtf8(data);
+    reader.report().writeToStdout();
+    if (reader.report().hasErrors())
+        return 1;
+
+    QFile outFile;
+    if (parser.isSet(optionOutput))
+    {
+        outFile.setFileName(parser.value(optionOutput));
+        if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        {
+            std::cerr << "Unable to open file for writing: " << qPrintable(outFile.errorString()) << std::endl;
+            return 1;
+        }
+    }
+    else outFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    QTextStream out(&outFile);
+
+    BatchCalc calc(&schema, &out);
+    if (parser.isSet(optionFunc))
+    {
+        QJsonParseError error;
+        auto args = QJsonDocument::fromJson(parser.value(optionArgs).toUtf8(), &error);
+        if (!args.isObject())
+        {
+            std::cerr << "Invalid function arguments: " << qPrintable(error.errorString()) << std::endl;
+            return 1;
+        }
+        calc.calcFunction(parser.value(optionFunc), args.object());
+    }
+    else
+        calc.calcStoredFunctions(QJsonDocument::fromJson(data).object());
+
+    out.flush();
+    calc.report().writeToStdout();
+    return calc.report().hasErrors() ? 1 : 0;
+}
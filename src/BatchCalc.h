@@ -0,0 +1,59 @@
+#ifndef BATCH_CALC_H
+#define BATCH_CALC_H
+
+#include "core/Report.h"
+
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QJsonObject;
+class QTextStream;
+QT_END_NAMESPACE
+
+class PlotFunction;
+class Schema;
+
+/**
+    Calculation of schema functions without GUI, used by the `--calc` command line mode.
+
+    Functions are calculated without any widgets, either all of those stored in function
+    windows of a schema file, or a single function given by its alias and arguments.
+    Arguments are given in the same JSON format as function windows store them,
+    elements can be referenced by `element_label` instead of `element_index`.
+
+    Results are written as tab-separated text, one point per line, values are in SI units.
+    Each function starts with a comment line `# <name>` followed by the header line.
+*/
+class BatchCalc
+{
+public:
+    BatchCalc(Schema* schema, QTextStream* out): _schema(schema), _out(out) {}
+
+    /// Calculates all functions stored in function windows of the schema file.
+    void calcStoredFunctions(const QJsonObject& root);
+
+    /// Calculates a function given by its alias (e.g. `Caustic` or `StabMap`) and arguments.
+    void calcFunction(const QString& alias, const QJsonObject& args, const QString& title = QString());
+
+    const Z::Report& report() const { return _report; }
+
+    /// Checks if the command line requests a batch calculation.
+    /// It should be checked before the application is created, as batch mode doesn't need widgets.
+    static bool isRequested(int argc, char* argv[]);
+
+    /// Runs batch calculation as described by the command line and returns the exit code.
+    static int run(const QStringList& arguments);
+
+    /// Makes a function by its alias, returns null for functions that can't be calculated in batch.
+    static PlotFunction* makeFunction(const QString& alias, Schema* schema);
+
+private:
+    Schema* _schema;
+    QTextStream* _out;
+    Z::Report _report;
+
+    void calcFunction(PlotFunction* func, const QString& title);
+    void writeResults(PlotFunction* func, const QString& title);
+};
+
+#endif // BATCH_CALC_H
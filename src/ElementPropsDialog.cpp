@@ -140,6 +140,8 @@ void ElementPropsDialog::collect()
         return;
     }
 
+    // Params driven by the edited ones are evaluated once, when all of them are applied
+    SchemaTransaction transaction(dynamic_cast<Schema*>(_element->owner()));
     ElementEventsLocker eventsLocker(_element);
     ElementMatrixLocker matrixLocker(_element, "ElementPropsDialog: apply params");
 
@@ -310,7 +310,7 @@ void ProjectOperations::createDefaultPump(Schema *schema)
 
 bool ProjectOperations::editPumpDlg(PumpParams* pump)
 {
-    return PumpParamsDialog::editPump(pump);
+    return PumpParamsDialog::editPump(pump, schema());
 }
 
 void ProjectOperations::setupPump()
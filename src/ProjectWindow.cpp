@@ -60,6 +60,9 @@ ProjectWindow::ProjectWindow(Schema* aSchema) : QMainWindow(), SchemaToolWindow(
     setAttribute(Qt::WA_DeleteOnClose);
     Ori::Wnd::setWindowIcon(this, ":/window_icons/main");
 
+    // Function windows are recalculated only once for a series of changes
+    schema()->events().setRecalcCoalescing(true);
+
     Ori::Settings s;
     s.beginGroup("View");
     s.restoreWindowGeometry("mainWindow", this);
@@ -3,6 +3,7 @@
 #include "Appearance.h"
 #include "HelpSystem.h"
 #include "core/Pump.h"
+#include "core/Schema.h"
 #include "core/Utils.h"
 #include "widgets/ParamsEditor.h"
 
@@ -91,14 +92,14 @@ PumpParams* PumpParamsDialog::makeNewPump()
     return nullptr;
 }
 
-bool PumpParamsDialog::editPump(PumpParams *params)
+bool PumpParamsDialog::editPump(PumpParams *params, Schema *schema)
 {
-    auto dlg = new PumpParamsDialog(params);
+    auto dlg = new PumpParamsDialog(params, schema);
     return dlg->exec() == QDialog::Accepted;
 }
 
-PumpParamsDialog::PumpParamsDialog(PumpParams *params, QWidget *parent)
-    : RezonatorDialog(Options(UseHelpButton), parent), _params(params)
+PumpParamsDialog::PumpParamsDialog(PumpParams *params, Schema *schema, QWidget *parent)
+    : RezonatorDialog(Options(UseHelpButton), parent), _params(params), _schema(schema)
 {
     auto pumpMode = Pumps::findByModeName(params->modeName());
     if (!pumpMode)
@@ -153,6 +154,7 @@ void PumpParamsDialog::showEvent(QShowEvent *event)
 
 void PumpParamsDialog::collect()
 {
+    SchemaTransaction transaction(_schema);
     _params->setLabel(_editorLabel->text().trimmed());
     _params->setTitle(_editorTitle->text().trimmed());
     _paramsEditor->collect();
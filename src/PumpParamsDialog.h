@@ -9,16 +9,20 @@ QT_END_NAMESPACE
 
 class ParamsEditorTS;
 class PumpParams;
+class Schema;
 
 class PumpParamsDialog : public RezonatorDialog
 {
     Q_OBJECT
 
 public:
-    explicit PumpParamsDialog(PumpParams *params, QWidget *parent = nullptr);
+    explicit PumpParamsDialog(PumpParams *params, Schema *schema = nullptr, QWidget *parent = nullptr);
 
     static PumpParams *makeNewPump();
-    static bool editPump(PumpParams *params);
+
+    /// Edits params of the pump. When the pump belongs to a schema,
+    /// new params are applied to it in a schema transaction.
+    static bool editPump(PumpParams *params, Schema *schema = nullptr);
 
 public slots:
     void collect() override;
@@ -29,6 +33,7 @@ protected:
 
 private:
     PumpParams *_params;
+    Schema *_schema;
     ParamsEditorTS *_paramsEditor;
     QLineEdit *_editorLabel;
     QLineEdit *_editorTitle;
@@ -329,7 +329,7 @@ PumpParams* PumpWindow::makeNewPumpDlg()
 
 bool PumpWindow::editPumpDlg(PumpParams* pump)
 {
-    return PumpParamsDialog::editPump(pump);
+    return PumpParamsDialog::editPump(pump, schema());
 }
 
 PumpParams* PumpWindow::selectedPump() const
@@ -382,7 +382,7 @@ void PumpWindow::deletePump()
     if (Ori::Dlg::ok(tr("Confirm deletion of pump %1").arg(pumpId)))
     {
         schema()->events().raise(SchemaEvents::PumpDeleting, pump, "PumpWindow: pump deleting");
-        schema()->pumps()->removeOne(pump);
+        schema()->removePump(pump);
         schema()->events().raise(SchemaEvents::PumpDeleted, pump, "PumpWindow: pump deleted");
         if (pump->isActive())
         {
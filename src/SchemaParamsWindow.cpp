@@ -197,7 +197,7 @@ void SchemaParamsWindow::deleteParameter()
     {
         schema()->events().raise(SchemaEvents::CustomParamDeleting, deletingParam, "Params window: param deleting");
         schema()->formulas()->free(deletingParam);
-        schema()->customParams()->removeOne(deletingParam);
+        schema()->removeCustomParam(deletingParam);
         schema()->events().raise(SchemaEvents::CustomParamDeleted, deletingParam, "Params window: param deleted");
     }
 }
@@ -41,6 +41,9 @@
 #define AXIS_LEN\
     double axisLengthSI() const override;
 
+#define HOMOGENEOUS\
+    bool isHomogeneous() const override { return true; }
+
 class Element;
 class PumpCalculator;
 
@@ -86,6 +89,12 @@ enum ElementOption {
     /// and passes new lambda value to all elements having this option set.
     /// The element must provide parameter "Lambda" for accepting wavelength.
     Element_RequiresWavelength = 0x08,
+
+    /// The element can produce matrices having non-zero imaginary parts
+    /// (e.g. Gaussian apertures and ducts), even if they are real for current parameters.
+    /// Round-trip calculator can't use fast real-valued multiplication
+    /// when there is such an element in the round-trip.
+    Element_ComplexMatrix = 0x10,
 };
 
 struct ElementLayoutOptions {
@@ -176,6 +185,9 @@ public:
     bool disabled() const { return _disabled; }
     void setDisabled(bool value);
 
+    /// Element doesn't report its changes to the owner, see @ref ElementEventsLocker.
+    bool eventsLocked() const { return _eventsLocked; }
+
     void setOption(ElementOption option) { _options |= option; }
     bool hasOption(ElementOption option) const { return _options & option; }
 
@@ -239,6 +251,11 @@ public:
     virtual double axisLengthSI() const { return lengthSI(); }
     virtual double opticalPathSI() const { return axisLengthSI()* ior(); }
 
+    /// Beam propagates inside a homogeneous range as in free space, so sub-range matrices
+    /// for any offset `x` are `Mt1(x) = [1 x; 0 1] * Mt1(0)`, and the same for `Ms1`.
+    /// Functions can use it to calculate beam along the range without round-trip for each point.
+    virtual bool isHomogeneous() const { return false; }
+
 protected:
     ElementRange();
 
@@ -315,18 +332,19 @@ protected:
 class ElementEventsLocker
 {
 public:
-    ElementEventsLocker(Element* elem): _elem(elem)
+    ElementEventsLocker(Element* elem): _elem(elem), _wasLocked(elem->_eventsLocked)
     {
         _elem->_eventsLocked = true;
     }
 
     ~ElementEventsLocker()
     {
-        _elem->_eventsLocked = false;
+        _elem->_eventsLocked = _wasLocked;
     }
 
 private:
     Element *_elem;
+    bool _wasLocked;
 };
 
 //------------------------------------------------------------------------------
@@ -334,13 +352,16 @@ private:
 class ElementMatrixLocker
 {
 public:
-    ElementMatrixLocker(Element* elem, const char* reason): _elem(elem), _reason(reason)
+    ElementMatrixLocker(Element* elem, const char* reason): _elem(elem), _reason(reason), _wasLocked(elem->_calcMatrixLocked)
     {
         _elem->_calcMatrixLocked = true;
     }
 
     ~ElementMatrixLocker()
     {
+        // Nested locker leaves the recalculation to the outer one
+        if (_wasLocked) return;
+
         _elem->_calcMatrixLocked = false;
 
         if (_elem->_calcMatrixNeeded)
@@ -353,6 +374,7 @@ public:
 private:
     Element *_elem;
     const char *_reason;
+    bool _wasLocked;
 };
 
 //------------------------------------------------------------------------------
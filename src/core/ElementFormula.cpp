@@ -17,6 +17,7 @@ bool ElemFormula::reopenLua()
 {
     if (_lua) delete _lua;
 
+    _compiled = false;
     _lua = new Z::Lua;
     _error = _lua->open();
     if (!_error.isEmpty())
@@ -51,17 +52,29 @@ void ElemFormula::calcMatrixInternal()
         return;
     }
 
-    for (auto param : _params)
-        _lua->setGlobalVar(param->alias(), param->value().toSi());
+    // The code is only compiled when changed, so nothing is parsed
+    // or allocated when the matrix is recalculated in a loop
+    if (!_compiled)
+    {
+        _error = _lua->compileChunk(_formula);
+        if (!_error.isEmpty())
+        {
+            setUnity();
+            return;
+        }
+        _compiled = true;
+    }
 
-    _error = _lua->setCode(_formula);
-    if (!_error.isEmpty())
+    if (_paramNames.size() != _params.size())
     {
-        setUnity();
-        return;
+        _paramNames.clear();
+        for (auto param : _params)
+            _paramNames << param->alias().toLatin1();
     }
+    for (int i = 0; i < _params.size(); i++)
+        _lua->setGlobalVar(_paramNames.at(i).constData(), _params.at(i)->value().toSi());
 
-    _error = _lua->execute();
+    _error = _lua->run();
     if (!_error.isEmpty())
     {
         setUnity();
@@ -70,43 +83,50 @@ void ElemFormula::calcMatrixInternal()
 
     double A, B, C, D;
 
-    auto results = _lua->getGlobalVars();
     if (_hasMatricesTS)
     {
-        if (!getResult(results, QStringLiteral("At"), A)) return;
-        if (!getResult(results, QStringLiteral("Bt"), B)) return;
-        if (!getResult(results, QStringLiteral("Ct"), C)) return;
-        if (!getResult(results, QStringLiteral("Dt"), D)) return;
+        if (!getResult("At", A)) return;
+        if (!getResult("Bt", B)) return;
+        if (!getResult("Ct", C)) return;
+        if (!getResult("Dt", D)) return;
         _mt.assign(A, B, C, D);
-        if (!getResult(results, QStringLiteral("As"), A)) return;
-        if (!getResult(results, QStringLiteral("Bs"), B)) return;
-        if (!getResult(results, QStringLiteral("Cs"), C)) return;
-        if (!getResult(results, QStringLiteral("Ds"), D)) return;
+        if (!getResult("As", A)) return;
+        if (!getResult("Bs", B)) return;
+        if (!getResult("Cs", C)) return;
+        if (!getResult("Ds", D)) return;
         _ms.assign(A, B, C, D);
     }
     else
     {
-        if (!getResult(results, QStringLiteral("A"), A)) return;
-        if (!getResult(results, QStringLiteral("B"), B)) return;
-        if (!getResult(results, QStringLiteral("C"), C)) return;
-        if (!getResult(results, QStringLiteral("D"), D)) return;
+        if (!getResult("A", A)) return;
+        if (!getResult("B", B)) return;
+        if (!getResult("C", C)) return;
+        if (!getResult("D", D)) return;
         _mt.assign(A, B, C, D);
         _ms.assign(A, B, C, D);
     }
 }
 
-bool ElemFormula::getResult(const QMap<QString, double>& results, const QString& name, double& result)
+bool ElemFormula::getResult(const char* name, double& result)
 {
-    if (!results.contains(name))
+    auto res = _lua->getGlobalVar(name);
+    if (!res.ok())
     {
         _error = qApp->translate("ElemFormula", "Formula doesn't contain an expression for '%1' or it is not a number").arg(name);
         setUnity();
         return false;
     }
-    result = results[name];
+    result = res.value();
     return true;
 }
 
+void ElemFormula::setFormula(const QString& formula)
+{
+    if (_formula == formula) return;
+    _formula = formula;
+    _compiled = false;
+}
+
 void ElemFormula::setUnity()
 {
     _mt.unity();
@@ -121,6 +141,7 @@ void ElemFormula::addParam(Z::Parameter* param, int index)
         return;
     }
     Element::addParam(param, index);
+    _paramNames.clear();
 }
 
 void ElemFormula::removeParam(Z::Parameter* param)
@@ -131,6 +152,7 @@ void ElemFormula::removeParam(Z::Parameter* param)
         if (p == param)
         {
             _params.removeAt(i);
+            _paramNames.clear();
             delete p;
             return;
         }
@@ -153,6 +175,7 @@ void ElemFormula::moveParamUp(Z::Parameter* param)
     }
     else
         _params.swapItemsAt(index, index-1);
+    _paramNames.clear();
 }
 
 void ElemFormula::moveParamDown(Z::Parameter* param)
@@ -170,12 +193,14 @@ void ElemFormula::moveParamDown(Z::Parameter* param)
     }
     else
         _params.swapItemsAt(index, index+1);
+    _paramNames.clear();
 }
 
 void ElemFormula::assign(const ElemFormula* other)
 {
     qDeleteAll(_params);
     _params.clear();
+    _paramNames.clear();
 
     for (const auto p : other->params())
     {
@@ -189,6 +214,6 @@ void ElemFormula::assign(const ElemFormula* other)
         paramCopy->setValue(p->value());
         addParam(paramCopy);
     }
-    _formula = other->formula();
+    setFormula(other->formula());
     _hasMatricesTS = other->hasMatricesTS();
 }
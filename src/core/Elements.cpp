@@ -1038,6 +1038,7 @@ ElemGaussAperture::ElemGaussAperture() : Element()
 
     setOption(Element_ChangesWavefront);
     setOption(Element_RequiresWavelength);
+    setOption(Element_ComplexMatrix);
 }
 
 void ElemGaussAperture::calcMatrixInternal()
@@ -1097,6 +1098,7 @@ ElemGaussApertureLens::ElemGaussApertureLens() : Element()
 
     setOption(Element_ChangesWavefront);
     setOption(Element_RequiresWavelength);
+    setOption(Element_ComplexMatrix);
 
     _focusT->setVerifier(globalFocalLengthVerifier());
     _focusS->setVerifier(globalFocalLengthVerifier());
@@ -1168,6 +1170,7 @@ ElemGaussDuctMedium::ElemGaussDuctMedium() : ElementRange() {
     addParam(_alpha2s);
 
     setOption(Element_RequiresWavelength);
+    setOption(Element_ComplexMatrix);
 }
 
 void ElemGaussDuctMedium::calcMatrixInternal() {
@@ -1259,6 +1262,7 @@ ElemGaussDuctSlab::ElemGaussDuctSlab() : ElementRange() {
     addParam(_alpha2s);
 
     setOption(Element_RequiresWavelength);
+    setOption(Element_ComplexMatrix);
 }
 
 void ElemGaussDuctSlab::calcMatrixInternal() {
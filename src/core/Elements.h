@@ -10,6 +10,7 @@ DECLARE_ELEMENT(ElemEmptyRange, ElementRange)
     DEFAULT_LABEL("d")
     CALC_MATRIX
     SUB_RANGE
+    HOMOGENEOUS
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -20,6 +21,7 @@ DECLARE_ELEMENT(ElemMediumRange, ElementRange)
     DEFAULT_LABEL("d")
     CALC_MATRIX
     SUB_RANGE
+    HOMOGENEOUS
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -30,6 +32,7 @@ DECLARE_ELEMENT(ElemPlate, ElementRange)
     DEFAULT_LABEL("G")
     CALC_MATRIX
     SUB_RANGE
+    HOMOGENEOUS
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -93,6 +96,7 @@ DECLARE_ELEMENT(ElemTiltedCrystal, ElementRange)
     DEFAULT_LABEL("G")
     CALC_MATRIX
     SUB_RANGE
+    HOMOGENEOUS
     double alpha() const { return _alpha->value().toSi(); }
 protected:
     Z::Parameter *_alpha;
@@ -116,6 +120,7 @@ DECLARE_ELEMENT(ElemBrewsterCrystal, ElementRange)
     DEFAULT_LABEL("G")
     CALC_MATRIX
     SUB_RANGE
+    HOMOGENEOUS
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -126,6 +131,7 @@ DECLARE_ELEMENT(ElemBrewsterPlate, ElementRange)
     DEFAULT_LABEL("G")
     CALC_MATRIX
     SUB_RANGE
+    HOMOGENEOUS
     AXIS_LEN
 DECLARE_ELEMENT_END
 
@@ -218,6 +224,7 @@ DECLARE_ELEMENT(ElemThickLens, ElementRange)
     DEFAULT_LABEL("F")
     CALC_MATRIX
     SUB_RANGE
+    HOMOGENEOUS
     double radius1() const { return _radius1->value().toSi(); }
     double radius2() const { return _radius2->value().toSi(); }
 private:
@@ -248,6 +255,7 @@ DECLARE_ELEMENT(ElemGrinMedium, ElemMediumRange)
     DEFAULT_LABEL("GM")
     CALC_MATRIX
     SUB_RANGE
+    bool isHomogeneous() const override { return false; }
     double ior2t() const { return _ior2t->value().value(); }
     double ior2s() const { return _ior2s->value().value(); }
     Z::Parameter* paramIor2t() const { return _ior2t; }
@@ -278,6 +286,7 @@ DECLARE_ELEMENT(ElemThermoMedium, ElemMediumRange)
     DEFAULT_LABEL("TM")
     CALC_MATRIX
     SUB_RANGE
+    bool isHomogeneous() const override { return false; }
     double focus() const { return _focus->value().toSi(); }
 protected:
     Z::Parameter *_focus;
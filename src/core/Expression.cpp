@@ -0,0 +1,424 @@
+#include "Expression.h"
+
+#include <QRegularExpression>
+#include <QtMath>
+
+#include <cmath>
+
+namespace {
+
+typedef double (*FunctionPtr)(double);
+
+struct Function
+{
+    const char* name;
+    FunctionPtr func;
+};
+
+// Should give the same results as functions registered in Lua::registerGlobalFuncs()
+const Function functions[] = {
+    { "sin", [](double x){ return qSin(x); } },
+    { "sinh", [](double x){ return sinh(x); } },
+    { "asin", [](double x){ return qAsin(x); } },
+
+    { "cos", [](double x){ return qCos(x); } },
+    { "cosh", [](double x){ return cosh(x); } },
+    { "acos", [](double x){ return qAcos(x); } },
+
+    { "tan", [](double x){ return qTan(x); } },
+    { "tanh", [](double x){ return tanh(x); } },
+    { "atan", [](double x){ return qAtan(x); } },
+
+    { "cot", [](double x){ return 1.0 / qTan(x); } },
+    { "coth", [](double x){ return 1.0 / tanh(x); } },
+    { "acot", [](double x){ return qAtan(1.0 / x); } },
+
+    { "sec", [](double x){ return 1.0 / qCos(x); } },
+    { "sech", [](double x){ return 1.0 / cosh(x); } },
+    { "csc", [](double x){ return 1.0 / qSin(x); } },
+    { "csch", [](double x){ return 1.0 / sinh(x); } },
+
+    { "abs", [](double x){ return qAbs(x); } },
+    { "floor", [](double x){ return double(qFloor(x)); } },
+    { "ceil", [](double x){ return double(qCeil(x)); } },
+
+    { "exp", [](double x){ return qExp(x); } },
+    { "ln", [](double x){ return qLn(x); } },
+    { "lg", [](double x){ return log10(x); } },
+
+    { "sqrt", [](double x){ return qSqrt(x); } },
+
+    { "deg2rad", [](double x){ return qDegreesToRadians(x); } },
+    { "rad2deg", [](double x){ return qRadiansToDegrees(x); } },
+};
+
+const char* PI_FUNC = "pi";
+
+FunctionPtr findFunction(const QString& name)
+{
+    for (const Function& f : functions)
+        if (name == QLatin1String(f.name))
+            return f.func;
+    return nullptr;
+}
+
+} // namespace
+
+namespace Z {
+
+//------------------------------------------------------------------------------
+//                             Expression::Parser
+//------------------------------------------------------------------------------
+
+/**
+    Recursive descent parser following precedence of Lua operators:
+    `+ -` are lower than `* /`, then goes unary minus, and `^` is the highest
+    and right associative, so that `-a^2` is `-(a^2)` and `a^-b^c` is `a^(-(b^c))`.
+*/
+class Expression::Parser
+{
+public:
+    Parser(const QString& code, const QStringList& varNames, QVector<Op>& ops):
+        _code(code), _varNames(varNames), _ops(ops) {}
+
+    bool parse(int start)
+    {
+        _pos = start;
+        next();
+        return parseSum() && _token == TokEnd;
+    }
+
+    int maxDepth() const { return _maxDepth; }
+
+private:
+    enum Token
+    {
+        TokEnd,
+        TokError,
+        TokNumber,
+        TokName,
+        TokPlus,
+        TokMinus,
+        TokMul,
+        TokDiv,
+        TokPow,
+        TokOpen,
+        TokClose,
+    };
+
+    const QString& _code;
+    const QStringList& _varNames;
+    QVector<Op>& _ops;
+    int _pos = 0;
+    Token _token = TokEnd;
+    double _number = 0;
+    QString _name;
+    int _depth = 0;
+    int _maxDepth = 0;
+
+    static bool isSpace(QChar c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    static bool isNameChar(QChar c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    QChar at(int pos) const { return pos < _code.size() ? _code.at(pos) : QChar(); }
+
+    void next()
+    {
+        while (isSpace(at(_pos))) _pos++;
+
+        QChar c = at(_pos);
+        if (c.isNull())
+        {
+            _token = TokEnd;
+            return;
+        }
+        if (c.isDigit() || (c == '.' && at(_pos+1).isDigit()))
+        {
+            nextNumber();
+            return;
+        }
+        if (isNameChar(c))
+        {
+            int start = _pos;
+            while (isNameChar(at(_pos))) _pos++;
+            _name = _code.mid(start, _pos - start);
+            _token = TokName;
+            return;
+        }
+        _pos++;
+        switch (c.toLatin1())
+        {
+        case '+': _token = TokPlus; break;
+        // Double minus starts a comment in Lua
+        case '-': _token = at(_pos) == '-' ? TokError : TokMinus; break;
+        case '*': _token = TokMul; break;
+        case '/': _token = at(_pos) == '/' ? TokError : TokDiv; break;
+        case '^': _token = TokPow; break;
+        case '(': _token = TokOpen; break;
+        case ')': _token = TokClose; break;
+        default: _token = TokError;
+        }
+    }
+
+    void nextNumber()
+    {
+        int start = _pos;
+        while (at(_pos).isDigit()) _pos++;
+        if (at(_pos) == '.')
+        {
+            _pos++;
+            while (at(_pos).isDigit()) _pos++;
+        }
+        if (at(_pos) == 'e' || at(_pos) == 'E')
+        {
+            _pos++;
+            if (at(_pos) == '+' || at(_pos) == '-') _pos++;
+            if (!at(_pos).isDigit())
+            {
+                _token = TokError;
+                return;
+            }
+            while (at(_pos).isDigit()) _pos++;
+        }
+        // Lua treats things like `2x` or `0x10` as malformed or hex numbers
+        if (isNameChar(at(_pos)) || at(_pos) == '.')
+        {
+            _token = TokError;
+            return;
+        }
+        bool ok;
+        _number = _code.midRef(start, _pos - start).toDouble(&ok);
+        _token = ok ? TokNumber : TokError;
+    }
+
+    void emit(const Op& op)
+    {
+        switch (op.code)
+        {
+        case OpNumber:
+        case OpVar:
+            _depth++;
+            _maxDepth = qMax(_maxDepth, _depth);
+            break;
+        case OpAdd:
+        case OpSub:
+        case OpMul:
+        case OpDiv:
+        case OpPow:
+            _depth--;
+            break;
+        case OpNeg:
+        case OpFunc:
+            break;
+        }
+        _ops << op;
+    }
+
+    void emit(OpCode code)
+    {
+        Op op;
+        op.code = code;
+        emit(op);
+    }
+
+    bool parseSum()
+    {
+        if (!parseProduct()) return false;
+        while (_token == TokPlus || _token == TokMinus)
+        {
+            OpCode code = _token == TokPlus ? OpAdd : OpSub;
+            next();
+            if (!parseProduct()) return false;
+            emit(code);
+        }
+        return true;
+    }
+
+    bool parseProduct()
+    {
+        if (!parseUnary()) return false;
+        while (_token == TokMul || _token == TokDiv)
+        {
+            OpCode code = _token == TokMul ? OpMul : OpDiv;
+            next();
+            if (!parseUnary()) return false;
+            emit(code);
+        }
+        return true;
+    }
+
+    bool parseUnary()
+    {
+        if (_token == TokMinus)
+        {
+            next();
+            if (!parseUnary()) return false;
+            emit(OpNeg);
+            return true;
+        }
+        return parsePower();
+    }
+
+    bool parsePower()
+    {
+        if (!parsePrimary()) return false;
+        if (_token == TokPow)
+        {
+            next();
+            if (!parseUnary()) return false;
+            emit(OpPow);
+        }
+        return true;
+    }
+
+    bool parsePrimary()
+    {
+        if (_token == TokNumber)
+        {
+            Op op;
+            op.code = OpNumber;
+            op.number = _number;
+            emit(op);
+            next();
+            return true;
+        }
+        if (_token == TokOpen)
+        {
+            next();
+            if (!parseSum() || _token != TokClose) return false;
+            next();
+            return true;
+        }
+        if (_token == TokName)
+        {
+            QString name = _name;
+            next();
+            // Variables are locals of Lua chunk, they hide functions having the same names,
+            // the last one of the same named variables is visible
+            int var = _varNames.lastIndexOf(name);
+            if (_token != TokOpen)
+            {
+                if (var < 0) return false;
+                Op op;
+                op.code = OpVar;
+                op.var = var;
+                emit(op);
+                return true;
+            }
+            if (var >= 0) return false;
+            next();
+            if (name == QLatin1String(PI_FUNC))
+            {
+                if (_token != TokClose) return false;
+                next();
+                Op op;
+                op.code = OpNumber;
+                op.number = M_PI;
+                emit(op);
+                return true;
+            }
+            Op op;
+            op.code = OpFunc;
+            op.func = findFunction(name);
+            if (!op.func) return false;
+            if (!parseSum() || _token != TokClose) return false;
+            next();
+            emit(op);
+            return true;
+        }
+        return false;
+    }
+};
+
+//------------------------------------------------------------------------------
+//                                Expression
+//------------------------------------------------------------------------------
+
+bool Expression::compile(const QString& code, const QStringList& varNames)
+{
+    _ops.clear();
+    _stack.clear();
+
+    // The same assignment as is prepended to formulas calculated by Lua
+    static QRegularExpression resultVar("^\\s*ans\\s*=(?!=)");
+    auto match = resultVar.match(code);
+    int start = match.hasMatch() ? match.capturedEnd() : 0;
+
+    Parser parser(code, varNames, _ops);
+    if (!parser.parse(start))
+    {
+        _ops.clear();
+        return false;
+    }
+    _stack.resize(parser.maxDepth());
+    return true;
+}
+
+double Expression::calculate(const QVector<double>& vars)
+{
+    Q_ASSERT(ok());
+
+    double* stack = _stack.data();
+    const double* values = vars.constData();
+    int top = -1;
+    for (const Op& op : qAsConst(_ops))
+    {
+        switch (op.code)
+        {
+        case OpNumber:
+            stack[++top] = op.number;
+            break;
+
+        case OpVar:
+            stack[++top] = values[op.var];
+            break;
+
+        case OpNeg:
+            stack[top] = -stack[top];
+            break;
+
+        case OpAdd:
+            top--;
+            stack[top] += stack[top+1];
+            break;
+
+        case OpSub:
+            top--;
+            stack[top] -= stack[top+1];
+            break;
+
+        case OpMul:
+            top--;
+            stack[top] *= stack[top+1];
+            break;
+
+        case OpDiv:
+            top--;
+            stack[top] /= stack[top+1];
+            break;
+
+        case OpPow:
+            top--;
+            stack[top] = pow(stack[top], stack[top+1]);
+            break;
+
+        case OpFunc:
+            stack[top] = op.func(stack[top]);
+            break;
+        }
+    }
+    return stack[0];
+}
+
+bool Expression::isFunction(const QString& name)
+{
+    return name == QLatin1String(PI_FUNC) || findFunction(name);
+}
+
+} // namespace Z
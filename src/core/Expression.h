@@ -0,0 +1,68 @@
+#ifndef Z_EXPRESSION_H
+#define Z_EXPRESSION_H
+
+#include <QStringList>
+#include <QVector>
+
+namespace Z {
+
+/**
+    Native calculator of plain arithmetic expressions like `L1 + 2*d` or `sqrt(R1*R2)`.
+
+    An expression is compiled into a sequence of operations of a stack machine
+    which is much cheaper to run than a Lua chunk. Supported are numbers, named variables,
+    operators `+ - * / ^`, parentheses, and the same functions as registered for Lua formulas.
+    Operators have the same precedence as in Lua, so a compiled expression gives
+    the same result as when it is calculated by Lua.
+
+    Any code outside of this subset is not compiled and should be calculated by Lua,
+    it includes the code having errors, Lua will explain them better.
+*/
+class Expression
+{
+public:
+    /// Compiles code using given names of variables. Code can be either an expression
+    /// or an assignment of expression to the `ans` variable, as it is in formulas.
+    /// Returns false if code is not a plain arithmetic expression over these variables.
+    bool compile(const QString& code, const QStringList& varNames);
+
+    bool ok() const { return !_ops.isEmpty(); }
+
+    /// Calculates the compiled expression for values of variables
+    /// given in the same order as their names were given to @ref compile().
+    double calculate(const QVector<double>& vars);
+
+    /// Checks if the function is supported by compiled expressions.
+    static bool isFunction(const QString& name);
+
+private:
+    enum OpCode
+    {
+        OpNumber,
+        OpVar,
+        OpNeg,
+        OpAdd,
+        OpSub,
+        OpMul,
+        OpDiv,
+        OpPow,
+        OpFunc,
+    };
+
+    struct Op
+    {
+        OpCode code;
+        double number = 0;
+        int var = -1;
+        double (*func)(double) = nullptr;
+    };
+
+    class Parser;
+
+    QVector<Op> _ops;
+    QVector<double> _stack;
+};
+
+} // namespace Z
+
+#endif // Z_EXPRESSION_H
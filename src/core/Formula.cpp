@@ -3,6 +3,10 @@
 #include "LuaHelper.h"
 
 #include <QApplication>
+#include <QSet>
+
+#include <algorithm>
+#include <functional>
 
 namespace Z {
 
@@ -33,41 +37,90 @@ void Formula::calculate()
         return;
     }
 
-    Z::Lua lua;
-    _status = lua.open();
-    if (!_status.isEmpty())
+    if (!_compiled)
+        compile();
+    if (!_compileError.isEmpty())
     {
+        _status = _compileError;
         Z_ERROR(QString("Bad formula for param '%1': %2").arg(_target->alias(), _status))
         return;
     }
 
-    for (auto dep : _deps)
-        lua.setGlobalVar(dep->alias(), dep->value().toSi());
+    for (int i = 0; i < _deps.size(); i++)
+        _args[i] = _deps.at(i)->value().toSi();
 
-    auto res = lua.calculate(_code);
-    if (!res.ok())
+    double valueSi;
+    if (_expr.ok())
+        valueSi = _expr.calculate(_args);
+    else
     {
-        _status = res.error();
-        Z_ERROR(QString("Bad formula for param '%1': %2").arg(_target->alias(), _status))
-        return;
+        auto res = _lua.call(_args);
+        if (!res.ok())
+        {
+            _status = res.error();
+            Z_ERROR(QString("Bad formula for param '%1': %2").arg(_target->alias(), _status))
+            return;
+        }
+        valueSi = res.value();
     }
 
     auto unit = _target->value().unit();
-    auto value = unit->fromSi(res.value());
+    auto value = unit->fromSi(valueSi);
     _target->setValue(Value(value, unit));
     _status.clear();
 }
 
+void Formula::compile()
+{
+    _compiled = true;
+    _args.resize(_deps.size());
+
+    QStringList argNames;
+    for (auto dep : _deps)
+        argNames << dep->alias();
+
+    if (_expr.compile(_code, argNames))
+    {
+        _compileError.clear();
+        return;
+    }
+
+    if (!_lua.isOpen())
+    {
+        _compileError = _lua.open();
+        if (!_compileError.isEmpty())
+            return;
+    }
+    _compileError = _lua.compile(_code, argNames);
+}
+
+void Formula::setCode(const QString& code)
+{
+    if (_code == code) return;
+    _code = code;
+    _compiled = false;
+}
+
+void Formula::parameterChanged(ParameterBase* param)
+{
+    if (_propagator)
+        _propagator->sourceChanged(param);
+    else
+        calculate();
+}
+
 void Formula::addDep(Parameter* param)
 {
     _deps.append(param);
     param->addListener(this);
+    _compiled = false;
 }
 
 void Formula::removeDep(Parameter* param)
 {
     param->removeListener(this);
     _deps.removeAll(param);
+    _compiled = false;
 }
 
 void Formula::assignDeps(const Formula *formula)
@@ -90,6 +143,7 @@ QString Formula::displayStr() const
 
 void Formulas::put(Formula* f)
 {
+    f->setPropagator(_propagator);
     auto p = f->target();
     if (_items.contains(p))
     {
@@ -160,6 +214,66 @@ Parameters Formulas::dependentParams(Parameter *whichParam) const
     return result;
 }
 
+void Formulas::setPropagator(ParamPropagator* propagator)
+{
+    _propagator = propagator;
+    for (Formula *formula : _items.values())
+        formula->setPropagator(propagator);
+}
+
+//------------------------------------------------------------------------------
+
+ParamGraph::ParamGraph(Formulas* formulas, ParamLinks* links)
+{
+    for (Formula *formula : formulas->items().values())
+    {
+        _formulas.insert(formula->target(), formula);
+        for (Parameter *dep : formula->deps())
+            _targets[dep] << formula->target();
+    }
+    for (ParamLink *link : *links)
+    {
+        _links.insert(link->target(), link);
+        _targets[link->source()] << link->target();
+    }
+}
+
+Parameters ParamGraph::dependents(const QList<ParameterBase*>& sources) const
+{
+    // Reversed post-order of depth-first search is a topological order
+    Parameters order;
+    QSet<ParameterBase*> visited;
+    std::function<void(Parameter*)> visit = [&](Parameter* param)
+    {
+        visited.insert(param);
+        for (Parameter *target : _targets.value(param))
+            if (!visited.contains(target))
+                visit(target);
+        order << param;
+    };
+    for (ParameterBase *source : sources)
+        visited.insert(source);
+    for (ParameterBase *source : sources)
+        for (Parameter *target : _targets.value(source))
+            if (!visited.contains(target))
+                visit(target);
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+void ParamGraph::evaluate(Parameter* target) const
+{
+    auto formula = _formulas.value(target);
+    if (formula)
+    {
+        formula->calculate();
+        return;
+    }
+    auto link = _links.value(target);
+    if (link)
+        link->apply();
+}
+
 //------------------------------------------------------------------------------
 
 namespace FormulaUtils {
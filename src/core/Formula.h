@@ -1,8 +1,11 @@
 #ifndef FORMULA_H
 #define FORMULA_H
 
+#include "Expression.h"
+#include "LuaHelper.h"
 #include "Parameters.h"
 
+#include <QHash>
 #include <QMap>
 
 namespace Z {
@@ -10,6 +13,10 @@ namespace Z {
 /**
     Formula can calculate an expression given as a string and assign the result to the target parameter.
     It can have other parameters as dependencies and use their names in the expression.
+
+    The expression is compiled once and kept in a Lua state owned by the formula,
+    it is only recompiled when its code or the set of dependencies is changed.
+    Plain arithmetic expressions are compiled into @ref Expression and calculated without Lua.
 */
 class Formula : public ParameterListener
 {
@@ -24,7 +31,7 @@ public:
     const Z::Parameters& deps() { return _deps; }
 
     const QString& code() const { return _code; }
-    void setCode(const QString& code) { _code = code; }
+    void setCode(const QString& code);
 
     bool ok() const { return _status.isEmpty(); }
     const QString& status() const { return _status; }
@@ -33,15 +40,28 @@ public:
     void removeDep(Parameter* param);
     void assignDeps(const Formula *formula);
 
-    void parameterChanged(ParameterBase*) override { calculate(); }
+    void parameterChanged(ParameterBase* param) override;
+
+    void setPropagator(ParamPropagator* propagator) { _propagator = propagator; }
 
     QString displayStr() const;
 
+    /// Checks if the formula is calculated natively, without Lua.
+    bool isNative() const { return _expr.ok(); }
+
 private:
     Parameter* _target;
     Parameters _deps;
     QString _code;
     QString _status;
+    ParamPropagator* _propagator = nullptr;
+    Lua _lua;
+    Expression _expr;
+    bool _compiled = false;
+    QString _compileError;
+    QVector<double> _args;
+
+    void compile();
 };
 
 //------------------------------------------------------------------------------
@@ -65,8 +85,45 @@ public:
     /// Returns list of parameter which depends on specified parameter.
     Parameters dependentParams(Parameter *whichParam) const;
 
+    /// Attaches all formulas to the propagator, including the formulas put later.
+    void setPropagator(ParamPropagator* propagator);
+
 private:
     QMap<Parameter*, Formula*> _items;
+    ParamPropagator* _propagator = nullptr;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+    Dependency graph of parameters driven by formulas and links.
+
+    A parameter can drive others directly and through a chain of driven parameters,
+    and the same parameter can be reached by several paths. The graph gives an order
+    of evaluation of all parameters affected by a change, in which each of them
+    goes after all of its sources, so it is calculated only once and from actual values.
+*/
+class ParamGraph
+{
+public:
+    ParamGraph(Formulas* formulas, ParamLinks* links);
+
+    /// Returns all parameters driven by the given one directly or indirectly
+    /// in order in which they should be evaluated.
+    Parameters dependents(ParameterBase* source) const { return dependents(QList<ParameterBase*>{source}); }
+
+    /// Returns all parameters driven by any of the given ones in order in which they should be
+    /// evaluated, each of them is evaluated once even when it depends on several of the sources.
+    /// Sources themselves are not included, they are taken as they are.
+    Parameters dependents(const QList<ParameterBase*>& sources) const;
+
+    /// Updates value of the driven parameter by its formula or link.
+    void evaluate(Parameter* target) const;
+
+private:
+    QHash<ParameterBase*, Parameters> _targets;
+    QHash<Parameter*, Formula*> _formulas;
+    QHash<Parameter*, ParamLink*> _links;
 };
 
 //------------------------------------------------------------------------------
@@ -131,6 +131,7 @@ void Lua::registerGlobalFuncs(lua_State* lua)
 QString Lua::open()
 {
     if (_lua) lua_close(_lua);
+    _funcRef = -1;
 
     _lua = luaL_newstate();
     if (!_lua)
@@ -141,16 +142,20 @@ QString Lua::open()
     return QString();
 }
 
-Z::Result<double> Lua::calculate(const QString& formula)
+static QString withResultVar(const QString& formula)
 {
-    Q_ASSERT(_lua);
-
     static QRegExp resultVar(RESULT_VAR "\\s*=");
     QString code = formula;
     int pos = code.indexOf(resultVar);
     if (pos < 0) code = (RESULT_VAR "=") + code;
+    return code;
+}
 
-    QString error = setCode(code);
+Z::Result<double> Lua::calculate(const QString& formula)
+{
+    Q_ASSERT(_lua);
+
+    QString error = setCode(withResultVar(formula));
     if (!error.isEmpty())
         return Z::Result<double>::fail(error);
 
@@ -182,6 +187,83 @@ QString Lua::execute()
     return QString();
 }
 
+QString Lua::compile(const QString& code, const QStringList& argNames)
+{
+    Q_ASSERT(_lua);
+
+    // Arguments and the result are locals of the chunk, so nothing is left in globals
+    // between calls. The prefix is in the same line as the code to keep line numbers.
+    QString prefix = QStringLiteral("local " RESULT_VAR ";");
+    if (!argNames.isEmpty())
+        prefix += QStringLiteral("local %1=...;").arg(argNames.join(','));
+    return compileChunk(prefix + withResultVar(code) + QStringLiteral("\nreturn " RESULT_VAR));
+}
+
+QString Lua::compileChunk(const QString& code)
+{
+    Q_ASSERT(_lua);
+
+    if (_funcRef >= 0)
+    {
+        luaL_unref(_lua, LUA_REGISTRYINDEX, _funcRef);
+        _funcRef = -1;
+    }
+
+    QString error = setCode(code);
+    if (!error.isEmpty())
+    {
+        lua_pop(_lua, 1);
+        return error;
+    }
+
+    _funcRef = luaL_ref(_lua, LUA_REGISTRYINDEX);
+    return QString();
+}
+
+QString Lua::run()
+{
+    Q_ASSERT(_lua);
+    Q_ASSERT(_funcRef >= 0);
+
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, _funcRef);
+    int res = lua_pcall(_lua, 0, 0, 0);
+    if (res != LUA_OK)
+    {
+        QString error = getLuaError(res);
+        lua_pop(_lua, 1);
+        return error;
+    }
+    return QString();
+}
+
+Z::Result<double> Lua::call(const QVector<double>& args)
+{
+    Q_ASSERT(_lua);
+    Q_ASSERT(_funcRef >= 0);
+
+    if (!lua_checkstack(_lua, args.size() + 1))
+        return Z::Result<double>::fail(qApp->translate("Formula", "Not enough memory to initialize formula parser"));
+
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, _funcRef);
+    for (double arg : args)
+        lua_pushnumber(_lua, arg);
+
+    int res = lua_pcall(_lua, args.size(), 1, 0);
+    if (res != LUA_OK)
+    {
+        QString error = getLuaError(res);
+        lua_pop(_lua, 1);
+        return Z::Result<double>::fail(error);
+    }
+
+    bool isNumber = lua_type(_lua, -1) == LUA_TNUMBER;
+    double value = lua_tonumber(_lua, -1);
+    lua_pop(_lua, 1);
+    if (!isNumber)
+        return Z::Result<double>::fail(qApp->translate("Formula", "Variable '%1' is not a number").arg(RESULT_VAR));
+    return Z::Result<double>::success(value);
+}
+
 QString Lua::getLuaError(int errCode) const
 {
     Q_ASSERT(_lua);
@@ -223,10 +305,11 @@ Z::Result<double> Lua::getGlobalVar(const char* name)
     Q_ASSERT(_lua);
 
     int valueType = lua_getglobal(_lua, name);
+    auto value = lua_tonumber(_lua, -1);
+    lua_pop(_lua, 1);
     if (valueType != LUA_TNUMBER)
         return Z::Result<double>::fail(qApp->translate("Formula", "Variable '%1' is not a number").arg(name));
 
-    auto value = lua_tonumber(_lua, -1);
     return Z::Result<double>::success(value);
 }
 
@@ -257,11 +340,16 @@ QMap<QString, double> Lua::getGlobalVars()
 }
 
 void Lua::setGlobalVar(const QString& name, double value)
+{
+    setGlobalVar(name.toLatin1().constData(), value);
+}
+
+void Lua::setGlobalVar(const char* name, double value)
 {
     if (!_lua) return;
 
     lua_pushnumber(_lua, value);
-    lua_setglobal(_lua, name.toLatin1().data());
+    lua_setglobal(_lua, name);
 }
 
 void Lua::setGlobalVars(const QMap<QString, double>& vars)
@@ -3,6 +3,8 @@
 
 #include "CommonTypes.h"
 
+#include <QStringList>
+
 struct lua_State;
 
 namespace Z {
@@ -14,19 +16,35 @@ public:
 
 
     QString open();
+    bool isOpen() const { return _lua; }
     Z::Result<double> calculate(const QString& code);
     QString setCode(const QString& code);
     QString execute();
     Z::Result<double> getGlobalVar(const char* name);
     QMap<QString, double> getGlobalVars();
     void setGlobalVar(const QString& name, double value);
+    void setGlobalVar(const char* name, double value);
     void setGlobalVars(const QMap<QString, double>& vars);
     void removeGlobalVar(const QString& name);
 
+    /// Compiles code into a function taking values of the named variables as its arguments.
+    /// The function is kept in the state and can be called many times without recompilation.
+    QString compile(const QString& code, const QStringList& argNames);
+
+    /// Calls the function made by @ref compile() with values of its arguments.
+    Z::Result<double> call(const QVector<double>& args);
+
+    /// Compiles code and keeps it in the state, so it can be executed many times by @ref run().
+    QString compileChunk(const QString& code);
+
+    /// Executes the code compiled by @ref compileChunk().
+    QString run();
+
     static void registerGlobalFuncs(lua_State* lua);
 
 private:
     lua_State* _lua = nullptr;
+    int _funcRef = -1;
 
     QString getLuaError(int errCode) const;
     QString refineLuaError(const QString& err) const;
@@ -60,6 +60,95 @@ bool Matrix::isReal() const
     return A.imag() == 0 && B.imag() == 0 && C.imag() == 0 && D.imag() == 0;
 }
 
+//------------------------------------------------------------------------------
+//                                RealMatrix
+//------------------------------------------------------------------------------
+
+QString RealMatrix::str() const
+{
+    return QString("[A=%1; B=%2; C=%3; D=%4]").arg(Z::str(A), Z::str(B), Z::str(C), Z::str(D));
+}
+
+//------------------------------------------------------------------------------
+//                                MatrixBatch
+//------------------------------------------------------------------------------
+
+void MatrixBatch::reserve(int size)
+{
+    for (auto coeff : { &_A, &_B, &_C, &_D })
+        coeff->reserve(size);
+}
+
+void MatrixBatch::clear()
+{
+    for (auto coeff : { &_A, &_B, &_C, &_D, &_imA, &_imB, &_imC, &_imD })
+        coeff->clear();
+    _isReal = true;
+}
+
+void MatrixBatch::append(const Matrix& m)
+{
+    if (_isReal && !m.isReal())
+    {
+        // Imaginary parts of all previous matrices are zero
+        for (auto coeff : { &_imA, &_imB, &_imC, &_imD })
+            coeff->fill(0, _A.size());
+        _isReal = false;
+    }
+    _A.append(m.A.real());
+    _B.append(m.B.real());
+    _C.append(m.C.real());
+    _D.append(m.D.real());
+    if (!_isReal)
+    {
+        _imA.append(m.A.imag());
+        _imB.append(m.B.imag());
+        _imC.append(m.C.imag());
+        _imD.append(m.D.imag());
+    }
+}
+
+Matrix MatrixBatch::at(int index) const
+{
+    if (_isReal)
+        return Matrix(_A.at(index), _B.at(index), _C.at(index), _D.at(index));
+    return Matrix(Complex(_A.at(index), _imA.at(index)), Complex(_B.at(index), _imB.at(index)),
+                  Complex(_C.at(index), _imC.at(index)), Complex(_D.at(index), _imD.at(index)));
+}
+
+//------------------------------------------------------------------------------
+//                             MatrixProductTree
+//------------------------------------------------------------------------------
+
+void MatrixProductTree::build(const MatrixArray& matrs)
+{
+    _matrs = matrs;
+    _leafs = 1;
+    while (_leafs < _matrs.size())
+        _leafs *= 2;
+    _nodes.fill(Matrix(), 2 * _leafs);
+    for (int i = 0; i < _matrs.size(); i++)
+        _nodes[_leafs + i] = *_matrs.at(i);
+    for (int i = _leafs - 1; i > 0; i--)
+        _nodes[i] = _nodes.at(2 * i) * _nodes.at(2 * i + 1);
+}
+
+void MatrixProductTree::clear()
+{
+    _matrs.clear();
+    _nodes.clear();
+    _leafs = 0;
+}
+
+void MatrixProductTree::update(int index)
+{
+    if (index < 0 || index >= _matrs.size()) return;
+    int i = _leafs + index;
+    _nodes[i] = *_matrs.at(index);
+    for (i /= 2; i > 0; i /= 2)
+        _nodes[i] = _nodes.at(2 * i) * _nodes.at(2 * i + 1);
+}
+
 //------------------------------------------------------------------------------
 //                                RayVector
 //------------------------------------------------------------------------------
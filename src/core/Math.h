@@ -62,6 +62,132 @@ typedef QVector<const Matrix*> MatrixArray;
 
 //------------------------------------------------------------------------------
 
+/**
+    The ABCD ray matrix having only real elements.
+
+    It is used as an accumulator for products of matrices when all of them
+    are known to have zero imaginary parts. Real multiplication is several times
+    faster than complex one (see tests/perf_test_mult_matrs.cpp).
+*/
+class RealMatrix
+{
+public:
+    double A, B, C, D;
+
+    RealMatrix() : A(1), B(0), C(0), D(1) {}
+    RealMatrix(double a, double b, double c, double d) : A(a), B(b), C(c), D(d) {}
+
+    /// Takes real parts of the complex matrix, imaginary parts are ignored.
+    explicit RealMatrix(const Matrix& m) : A(m.A.real()), B(m.B.real()), C(m.C.real()), D(m.D.real()) {}
+
+    void unity()
+    {
+        A = 1; B = 0; C = 0; D = 1;
+    }
+
+    void assign(double a, double b, double c, double d)
+    {
+        A = a; B = b; C = c; D = d;
+    }
+
+    void operator *= (const RealMatrix &m)
+    {
+        double a = A * m.A + B * m.C;
+        double b = A * m.B + B * m.D;
+        double c = C * m.A + D * m.C;
+        double d = C * m.B + D * m.D;
+        assign(a, b, c, d);
+    }
+
+    /// Multiplies by real parts of the complex matrix, imaginary parts are ignored.
+    void operator *= (const Matrix *m)
+    {
+        double a = A * m->A.real() + B * m->C.real();
+        double b = A * m->B.real() + B * m->D.real();
+        double c = C * m->A.real() + D * m->C.real();
+        double d = C * m->B.real() + D * m->D.real();
+        assign(a, b, c, d);
+    }
+
+    Matrix toMatrix() const { return Matrix(A, B, C, D); }
+
+    QString str() const;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+    ABCD ray matrices of a batch of points in structure-of-arrays form.
+
+    Each coefficient of all matrices is stored in its own contiguous array,
+    so batch calculations can process them in tight loops which compilers are able to vectorize.
+    Imaginary parts are only stored when at least one of the matrices is complex,
+    batches of real matrices can be processed by real arithmetic.
+*/
+class MatrixBatch
+{
+public:
+    void reserve(int size);
+    void clear();
+    void append(const Matrix& m);
+
+    int size() const { return _A.size(); }
+    bool isEmpty() const { return _A.isEmpty(); }
+    bool isReal() const { return _isReal; }
+
+    /// Returns a matrix of the batch, it is for per-point calculations of complex batches.
+    Matrix at(int index) const;
+
+    /// Real parts of coefficients of all matrices.
+    const double* A() const { return _A.constData(); }
+    const double* B() const { return _B.constData(); }
+    const double* C() const { return _C.constData(); }
+    const double* D() const { return _D.constData(); }
+
+private:
+    QVector<double> _A, _B, _C, _D;
+    QVector<double> _imA, _imB, _imC, _imD;
+    bool _isReal = true;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+    Balanced binary tree of products over an array of matrices.
+
+    Each node stores a product of its children (in array order),
+    so the root is the product of the whole array. When a matrix in the array changes,
+    only products on the path from its leaf to the root are recalculated,
+    it takes O(log N) multiplications instead of O(N) for the whole array.
+    The tree refers to matrices by pointers, they must be alive while the tree is used.
+*/
+class MatrixProductTree
+{
+public:
+    void build(const MatrixArray& matrs);
+    void clear();
+
+    /// Recalculates products depending on the matrix at given index of the array.
+    void update(int index);
+
+    /// Product of all matrices of the array.
+    const Matrix& product() const { return _nodes.isEmpty() ? _unity : _nodes.at(1); }
+
+    int size() const { return _matrs.size(); }
+    bool isEmpty() const { return _matrs.isEmpty(); }
+
+private:
+    MatrixArray _matrs;
+
+    /// Nodes in heap order: the root is at index 1, children of node `i` are at `2i` and `2i+1`.
+    /// Leafs start at index `_leafs`, extra leafs above the array size are unity matrices.
+    QVector<Matrix> _nodes;
+    int _leafs = 0;
+    Matrix _unity;
+};
+
+//------------------------------------------------------------------------------
+
 class RayVector
 {
 public:
@@ -1,11 +1,20 @@
 #include "Parameters.h"
 
+#include <atomic>
+
 namespace Z {
 
 ParameterListener::~ParameterListener() {}
 
 ParameterBase::~ParameterBase() {}
 
+quint64 ParameterBase::nextChangeId()
+{
+    // Parameters of isolated schema copies can be changed in different threads
+    static std::atomic<quint64> lastId(0);
+    return ++lastId;
+}
+
 ParameterFilterCondition::~ParameterFilterCondition() {}
 
 } // namespace Z
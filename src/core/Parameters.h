@@ -26,6 +26,23 @@ public:
     virtual void parameterChanged(ParameterBase*) {}
 };
 
+//------------------------------------------------------------------------------
+/**
+    Object updating values of parameters driven by formulas and links.
+
+    When a driver (formula or link) is attached to a propagator, it doesn't update
+    its target on its own when a source parameter changes but passes the change
+    to the propagator which updates all driven parameters in proper order.
+*/
+class ParamPropagator
+{
+public:
+    virtual ~ParamPropagator() {}
+
+    /// Method is called by drivers when a value of their source parameter has been changed.
+    virtual void sourceChanged(ParameterBase* source) = 0;
+};
+
 //------------------------------------------------------------------------------
 /**
     Base class for schema parameters.
@@ -76,6 +93,11 @@ public:
     void addListener(ParameterListener* listener) { _listeners.append(listener); }
     void removeListener(ParameterListener* listener) { _listeners.removeAll(listener); }
 
+    /// Identifier of the last notification about a change of the parameter.
+    /// All listeners notified about the same change see the same id,
+    /// ids are unique among all parameters and never reused.
+    quint64 changeId() const { return _changeId; }
+
 protected:
     ParameterBase() {}
 
@@ -94,6 +116,7 @@ protected:
 
     void notifyListeners()
     {
+        _changeId = nextChangeId();
         for (auto listener: _listeners)
             listener->parameterChanged(this);
     }
@@ -102,6 +125,11 @@ protected:
     QString _alias, _label, _name, _description, _category;
     bool _visible = true;
     QVector<ParameterListener*> _listeners;
+
+private:
+    quint64 _changeId = 0;
+
+    static quint64 nextChangeId();
 };
 
 //------------------------------------------------------------------------------
@@ -282,9 +310,15 @@ public:
 
     void parameterChanged(ParameterBase *param) override
     {
-        if (param == _source) apply();
+        if (param != _source) return;
+        if (_propagator)
+            _propagator->sourceChanged(param);
+        else
+            apply();
     }
 
+    void setPropagator(ParamPropagator* propagator) { _propagator = propagator; }
+
     void apply() const
     {
         auto value = _source->value();
@@ -308,22 +342,50 @@ public:
 private:
     TParam *_source, *_target;
     int _options = 0;
+    ParamPropagator* _propagator = nullptr;
 };
 
 //------------------------------------------------------------------------------
 /**
     Generic container for list of parameter links.
-    It's just a list with several additional methods.
+    The list doesn't expose the whole QList interface, links can only be added by
+    @ref append(), so each of them gets attached to the propagator of the list.
 */
 template <class TLink>
-class ParameterLinksList : public QList<TLink*>
+class ParameterLinksList
 {
 public:
-    ParameterLinksList(): QList<TLink*>() {}
+    typedef typename QList<TLink*>::const_iterator const_iterator;
+
+    /// Appends a link and attaches it to the propagator of the list.
+    void append(TLink* link)
+    {
+        link->setPropagator(_propagator);
+        _items.append(link);
+    }
+
+    ParameterLinksList& operator << (TLink* link) { append(link); return *this; }
+
+    bool removeOne(TLink* link) { return _items.removeOne(link); }
+
+    /// Attaches all links of the list to the propagator, including the links appended later.
+    void setPropagator(ParamPropagator* propagator)
+    {
+        _propagator = propagator;
+        for (TLink *link : _items)
+            link->setPropagator(propagator);
+    }
+
+    int size() const { return _items.size(); }
+    bool isEmpty() const { return _items.isEmpty(); }
+    bool contains(TLink* link) const { return _items.contains(link); }
+    TLink* at(int index) const { return _items.at(index); }
+    const_iterator begin() const { return _items.begin(); }
+    const_iterator end() const { return _items.end(); }
 
     TLink* bySource(const void *source) const
     {
-        for (TLink *link : *this)
+        for (TLink *link : _items)
             if (link->source() == source)
                 return link;
         return nullptr;
@@ -331,11 +393,15 @@ public:
 
     TLink* byTarget(const void *target) const
     {
-        for (TLink *link : *this)
+        for (TLink *link : _items)
             if (link->target() == target)
                 return link;
         return nullptr;
     }
+
+private:
+    QList<TLink*> _items;
+    ParamPropagator* _propagator = nullptr;
 };
 
 //------------------------------------------------------------------------------
@@ -3,6 +3,8 @@
 #include "Schema.h"
 #include "Utils.h"
 
+#include <QTimer>
+
 //------------------------------------------------------------------------------
 //                               SchemaListener
 //------------------------------------------------------------------------------
@@ -43,6 +45,8 @@ void SchemaEvents::raise(Event event, void *param, const char* reason) const
 {
     if (!_enabled) return;
 
+    if (enqueue(event, param, reason)) return;
+
     QString alias = _schema->alias();
     if (!alias.isEmpty())
         alias = QStringLiteral("[%1]: ").arg(alias);
@@ -50,6 +54,17 @@ void SchemaEvents::raise(Event event, void *param, const char* reason) const
     const EventProps& eventProps = propsOf(event);
     Z_REPORT(QStringLiteral("%1SchemaEvent: %2, reason=[%3]").arg(alias).arg(eventProps.name).arg(reason))
 
+    collectChanges(event, param);
+
+    if (event == RecalRequred)
+    {
+        if (_recalcCoalescing)
+            postponeRecalc();
+        else
+            deliverRecalc();
+        return;
+    }
+
     if (int(eventProps.nextState) != SchemaState::Current)
     {
         _schema->state().set(eventProps.nextState);
@@ -70,6 +85,173 @@ void SchemaEvents::raise(Event event, void *param, const char* reason) const
     }
 }
 
+bool SchemaEvents::enqueue(Event event, void *param, const char* reason) const
+{
+    if (!_schema->inTransaction()) return false;
+
+    switch (event)
+    {
+    // Change events are raised once when the transaction is committed
+    case Changed:
+    case ElemChanged:
+    case ParamsChanged:
+    case LambdaChanged:
+    case CustomParamEdited:
+    case CustomParamChanged:
+    case PumpChanged:
+    case RecalRequred:
+        for (const QueuedEvent& queued : _queue)
+            if (queued.event == event && queued.param == param)
+                return true;
+        _queue << QueuedEvent{event, param, reason};
+        return true;
+
+    // Objects being deleted can't wait for the commit,
+    // their queued changes are dropped when they leave the schema, see dropQueued()
+    default:
+        return false;
+    }
+}
+
+void SchemaEvents::dropQueued(void* param) const
+{
+    for (int i = _queue.size()-1; i >= 0; i--)
+        if (_queue.at(i).param == param)
+            _queue.removeAt(i);
+}
+
+void SchemaEvents::raiseQueued() const
+{
+    auto queue = _queue;
+    _queue.clear();
+
+    // Recalculation goes last, when all the changes are collected
+    bool recalc = false;
+    const char* recalcReason = nullptr;
+    for (const QueuedEvent& queued : queue)
+        if (queued.event == RecalRequred)
+        {
+            recalc = true;
+            recalcReason = queued.reason;
+        }
+        else raise(queued.event, queued.param, queued.reason);
+    if (recalc)
+        raise(RecalRequred, recalcReason);
+}
+
+void SchemaEvents::setRecalcCoalescing(bool on)
+{
+    _recalcCoalescing = on;
+    if (!on) flushRecalc();
+}
+
+void SchemaEvents::postponeRecalc() const
+{
+    _pendingRecalcs++;
+    if (_recalcPending)
+    {
+        _savedRecalcs++;
+        return;
+    }
+    _recalcPending = true;
+
+    // Without event loop there is nobody to deliver the event later
+    if (!QCoreApplication::instance())
+    {
+        flushRecalc();
+        return;
+    }
+
+    // Schema can be deleted before the event loop gets control
+    std::weak_ptr<bool> alive(_alive);
+    QTimer::singleShot(0, QCoreApplication::instance(), [this, alive]{
+        if (!alive.expired()) flushRecalc();
+    });
+}
+
+void SchemaEvents::flushRecalc() const
+{
+    if (!_recalcPending) return;
+    _recalcPending = false;
+
+    QString alias = _schema->alias();
+    if (!alias.isEmpty())
+        alias = QStringLiteral("[%1]: ").arg(alias);
+    Z_REPORT(QStringLiteral("%1SchemaEvent: %2, coalesced=%3, saved total=%4")
+             .arg(alias).arg(propsOf(RecalRequred).name).arg(_pendingRecalcs).arg(_savedRecalcs))
+    _pendingRecalcs = 0;
+
+    deliverRecalc();
+}
+
+void SchemaEvents::collectChanges(Event event, void *param) const
+{
+    switch (event)
+    {
+    case ElemChanged:
+    {
+        auto elem = reinterpret_cast<Element*>(param);
+        if (elem && !_changes.elements.contains(elem))
+            _changes.elements << elem;
+        break;
+    }
+    case CustomParamChanged:
+    {
+        auto p = reinterpret_cast<Z::Parameter*>(param);
+        if (p && !_changes.params.contains(p))
+            _changes.params << p;
+        break;
+    }
+    case LambdaChanged:
+        _changes.wavelength = true;
+        break;
+    case PumpCreated:
+    case PumpChanged:
+    case PumpDeleted:
+        _changes.pump = true;
+        break;
+    case Created:
+    case Loaded:
+    case Rebuilt:
+    case ElemCreated:
+    case ElemDeleted:
+    case ParamsChanged:
+    case CustomParamDeleted:
+        _changes.all = true;
+        break;
+    default:
+        break;
+    }
+}
+
+void SchemaEvents::deliverRecalc() const
+{
+    // Listeners can raise new events while recalculating, they are collected for the next time
+    SchemaChanges changes = _changes;
+    _changes.clear();
+
+    // Recalculation was requested for a reason not covered by events, so anything can be affected
+    if (changes.isEmpty())
+        changes.all = true;
+
+    int skipped = 0;
+    auto listeners = _schema->listeners();
+    for (SchemaListener* listener : listeners)
+    {
+        // Listeners are asked even when everything is changed, they can track the changes
+        bool affected = listener->recalcAffectedBy(_schema, changes);
+        if (affected || changes.all)
+            notify(listener, RecalRequred, nullptr);
+        else skipped++;
+    }
+    if (skipped > 0)
+    {
+        _skippedRecalcs += skipped;
+        Z_REPORT(QStringLiteral("SchemaEvent: %1, skipped by not affected listeners=%2, skipped total=%3")
+                 .arg(propsOf(RecalRequred).name).arg(skipped).arg(_skippedRecalcs))
+    }
+}
+
 const SchemaEvents::EventProps& SchemaEvents::propsOf(Event event)
 {
     static QMap<Event, EventProps> _props(
@@ -152,6 +334,9 @@ Schema::Schema(const QString &alias) : _alias(alias)
     _wavelength.setValue(Z::Value(980, Z::Units::nm()));
     _wavelength.addListener(this);
 
+    _formulas.setPropagator(this);
+    _paramLinks.setPropagator(this);
+
     _events._schema = this;
     _events.raise(SchemaEvents::Created, "Schema: schema constructor");
 }
@@ -160,12 +345,15 @@ Schema::~Schema()
 {
     _events.raise(SchemaEvents::Deleted, "schema: schema destructor");
 
+    // Formulas unsubscribe from their dependencies, so they go before params
+    _formulas.clear();
+
+    qDeleteAll(_transactionLocks);
+
     qDeleteAll(_items);
     qDeleteAll(_customParams);
     qDeleteAll(_pumps);
 
-    _formulas.clear();
-
     if (memo) delete memo;
 }
 
@@ -216,6 +404,9 @@ void Schema::insertElements(const Elements& elems, int index, Arg::RaiseEvents e
             _items.append(elem);
 
         elem->setOwner(this);
+
+        if (inTransaction())
+            lockTransactionMatrix(elem);
     }
 
     relinkInterfaces();
@@ -245,6 +436,17 @@ void Schema::deleteElements(const Elements& elems, Arg::RaiseEvents events, Arg:
         _items.removeOne(elem);
         elem->setOwner(nullptr);
         removeParamLinks(elem);
+
+        // Element leaving the schema doesn't wait for the commit
+        if (_transactionLocks.contains(elem))
+            delete _transactionLocks.take(elem);
+        if (inTransaction())
+        {
+            QList<Z::ParameterBase*> params;
+            for (auto param : elem->params())
+                params << param;
+            forgetTransactionChanges(elem, params);
+        }
     }
 
     relinkInterfaces();
@@ -279,6 +481,131 @@ void Schema::parameterChanged(Z::ParameterBase *param)
     }
 }
 
+void Schema::sourceChanged(Z::ParameterBase *source)
+{
+    // Parameters changed during propagation are already in the evaluation order
+    if (_propagating) return;
+
+    // Dependents of all sources changed in transaction are evaluated together on commit
+    if (inTransaction())
+    {
+        if (!_transactionSources.contains(source))
+            _transactionSources << source;
+        return;
+    }
+
+    // Each driver using the source calls this method when it gets notified about
+    // the change, but all dependents are evaluated when the first of them does
+    if (source->changeId() == _propagatedChangeId) return;
+    _propagatedChangeId = source->changeId();
+
+    propagate(Z::ParamGraph(&_formulas, &_paramLinks), {source});
+}
+
+void Schema::propagate(const Z::ParamGraph& graph, const QList<Z::ParameterBase*>& sources)
+{
+    auto targets = graph.dependents(sources);
+    if (targets.isEmpty()) return;
+
+    // Matrices of elements are recalculated and elements are reported as changed
+    // only once, after all their parameters have got their final values
+    Elements elems, reportedElems;
+    for (auto target : targets)
+    {
+        auto elem = Z::Utils::findElemByParam(this, target);
+        if (elem && !elems.contains(elem))
+        {
+            elems << elem;
+            if (!elem->eventsLocked())
+                reportedElems << elem;
+        }
+    }
+    {
+        std::vector<std::unique_ptr<ElementMatrixLocker>> matrixLocks;
+        std::vector<std::unique_ptr<ElementEventsLocker>> eventsLocks;
+        for (auto elem : elems)
+        {
+            matrixLocks.emplace_back(new ElementMatrixLocker(elem, "Schema: sourceChanged"));
+            eventsLocks.emplace_back(new ElementEventsLocker(elem));
+        }
+
+        _propagating = true;
+        for (auto target : targets)
+            graph.evaluate(target);
+        _propagating = false;
+    }
+
+    for (auto elem : reportedElems)
+        elementChanged(elem);
+}
+
+void Schema::beginTransaction()
+{
+    if (_transactionLevel++ > 0) return;
+
+    for (auto elem : _items)
+        lockTransactionMatrix(elem);
+}
+
+void Schema::lockTransactionMatrix(Element* elem)
+{
+    if (!_transactionLocks.contains(elem))
+        _transactionLocks.insert(elem, new ElementMatrixLocker(elem, "Schema: commitTransaction"));
+}
+
+void Schema::commitTransaction()
+{
+    if (_transactionLevel == 0)
+    {
+        qWarning() << "Schema::commitTransaction(): there is no transaction to commit";
+        return;
+    }
+    if (_transactionLevel > 1)
+    {
+        _transactionLevel--;
+        return;
+    }
+
+    // Driven params are evaluated while matrices are still locked and events are still queued
+    if (!_transactionSources.isEmpty())
+    {
+        auto sources = _transactionSources;
+        _transactionSources.clear();
+        propagate(Z::ParamGraph(&_formulas, &_paramLinks), sources);
+    }
+
+    // Each element recalculates its matrix here, if any of its params has been changed
+    qDeleteAll(_transactionLocks);
+    _transactionLocks.clear();
+
+    _transactionLevel = 0;
+    _events.raiseQueued();
+}
+
+void Schema::forgetTransactionChanges(void* object, const QList<Z::ParameterBase*>& params)
+{
+    _events.dropQueued(object);
+    for (auto param : params)
+    {
+        _events.dropQueued(param);
+        _transactionSources.removeAll(param);
+    }
+}
+
+void Schema::removeCustomParam(Z::Parameter* param)
+{
+    _customParams.removeOne(param);
+    if (inTransaction())
+        forgetTransactionChanges(param, {param});
+}
+
+void Schema::removePump(PumpParams* pump)
+{
+    _pumps.removeOne(pump);
+    if (inTransaction())
+        forgetTransactionChanges(pump, {});
+}
+
 void Schema::setTripType(TripType value)
 {
     if (_tripType == value) return;
@@ -16,6 +16,8 @@
 #include <QMap>
 #include <QPointer>
 
+#include <memory>
+
 class Schema;
 
 //------------------------------------------------------------------------------
@@ -27,6 +29,23 @@ using FreeElem = Ori::Argument<bool, struct FreeElemTag>;
 
 } // namespace Arg
 
+//------------------------------------------------------------------------------
+/**
+    Summary of schema changes made since the previous @a SchemaEvents::RecalRequred event.
+    It allows listeners to skip recalculation when they don't depend on what has been changed.
+*/
+struct SchemaChanges
+{
+    bool all = false;        ///< Something changed that affects any calculation (e.g. elements rearranged)
+    bool pump = false;       ///< Some pump was created, changed, or deleted
+    bool wavelength = false; ///< Schema wavelength was changed
+    Elements elements;       ///< Elements whose parameters were changed
+    QList<Z::Parameter*> params; ///< Custom parameters whose values were changed
+
+    bool isEmpty() const { return !all && !pump && !wavelength && elements.isEmpty() && params.isEmpty(); }
+    void clear() { *this = SchemaChanges(); }
+};
+
 //------------------------------------------------------------------------------
 /**
     Schema listener interface.
@@ -62,6 +81,11 @@ public:
     virtual void pumpDeleting(Schema*, PumpParams*) {}
     virtual void pumpDeleted(Schema*, PumpParams*) {}
     virtual void recalcRequired(Schema*) {}
+
+    /// Is called before @a recalcRequired() to check if the listener is affected by the changes.
+    /// Listeners returning false don't get the @a recalcRequired() notification,
+    /// except when @a SchemaChanges::all is set, then it goes to everyone anyway.
+    virtual bool recalcAffectedBy(Schema*, const SchemaChanges&) { return true; }
 };
 
 //------------------------------------------------------------------------------
@@ -142,10 +166,44 @@ public:
     void enable() { _enabled = true; }
     void disable() { _enabled = false; }
 
+    /// When enabled, all @a RecalRequred events raised during one turn of the event loop
+    /// are delivered to listeners as a single notification when control returns to the loop.
+    /// Other events are always delivered immediately.
+    void setRecalcCoalescing(bool on);
+    bool recalcCoalescing() const { return _recalcCoalescing; }
+
+    /// Delivers a postponed @a RecalRequred event immediately if there is one.
+    void flushRecalc() const;
+    bool recalcPending() const { return _recalcPending; }
+
+    /// Total number of recalculations saved due to coalescing of @a RecalRequred events.
+    int savedRecalcs() const { return _savedRecalcs; }
+
+    /// Changes collected from events raised since the last @a RecalRequred event was delivered.
+    const SchemaChanges& changes() const { return _changes; }
+
+    /// Total number of recalculations skipped by listeners not affected by changes.
+    int skippedRecalcs() const { return _skippedRecalcs; }
+
     static QString str(Event event) { return propsOf(event).name; }
 
 private:
     bool _enabled = true;
+    bool _recalcCoalescing = false;
+    mutable bool _recalcPending = false;
+    mutable int _pendingRecalcs = 0;
+    mutable int _savedRecalcs = 0;
+    mutable int _skippedRecalcs = 0;
+    mutable SchemaChanges _changes;
+    std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
+
+    struct QueuedEvent
+    {
+        Event event;
+        void* param;
+        const char* reason;
+    };
+    mutable QList<QueuedEvent> _queue;
 
     Schema *_schema;
     friend class Schema;
@@ -159,6 +217,14 @@ private:
     static const EventProps& propsOf(Event event);
 
     void notify(SchemaListener* listener, SchemaEvents::Event event, void* param) const;
+    void postponeRecalc() const;
+    void collectChanges(Event event, void* param) const;
+    void deliverRecalc() const;
+    bool enqueue(Event event, void* param, const char* reason) const;
+    void raiseQueued() const;
+
+    /// Forgets queued events of an object leaving the schema, it can be freed before commit.
+    void dropQueued(void* param) const;
 };
 
 //------------------------------------------------------------------------------
@@ -212,7 +278,7 @@ struct SchemaMemo
 
 //------------------------------------------------------------------------------
 
-class Schema : public ElementOwner, public Z::ParameterListener, public Ori::Notifier<SchemaListener>
+class Schema : public ElementOwner, public Z::ParameterListener, public Z::ParamPropagator, public Ori::Notifier<SchemaListener>
 {
 public:
     Schema(const QString& alias = QString());
@@ -262,6 +328,10 @@ public:
     /// Adiitional params that can be added by user and used in formulas.
     Z::Parameters* customParams() { return &_customParams; }
 
+    /// Removes the param from custom params without deleting it and without raising events.
+    /// Changes of the param made in the current transaction are not applied on commit.
+    void removeCustomParam(Z::Parameter* param);
+
     /// Linst of all links which bind elements' parameter to custom parameters.
     Z::ParamLinks* paramLinks() { return &_paramLinks; }
 
@@ -274,6 +344,10 @@ public:
     Z::Parameters globalParams() const;
 
     PumpsList* pumps() { return &_pumps; }
+
+    /// Removes the pump from the schema without deleting it and without raising events.
+    /// Changes of the pump made in the current transaction are not reported on commit.
+    void removePump(PumpParams* pump);
     PumpParams* activePump();
 
     void moveElementUp(Element* elem);
@@ -282,7 +356,15 @@ public:
 
     void markModified(const char* reason);
 
-    SchemaMemo* memo;
+    /// Starts a bulk change of the schema. Until the transaction is committed,
+    /// matrices of elements are not recalculated, formulas and links are not evaluated,
+    /// and change events are not raised. Then each of them is done once on commit.
+    /// Transactions can be nested, only the outermost commit applies the changes.
+    void beginTransaction();
+    void commitTransaction();
+    bool inTransaction() const { return _transactionLevel > 0; }
+
+    SchemaMemo* memo = nullptr;
 
 private:
     Elements _items;
@@ -297,6 +379,11 @@ private:
     Z::ParamLinks _paramLinks;
     Z::Formulas _formulas;
     PumpsList _pumps;
+    bool _propagating = false;
+    quint64 _propagatedChangeId = 0;
+    int _transactionLevel = 0;
+    QMap<Element*, ElementMatrixLocker*> _transactionLocks;
+    QList<Z::ParameterBase*> _transactionSources;
 
     // inherits from ElementOwner
     void elementChanged(Element *elem) override;
@@ -304,6 +391,17 @@ private:
     // inherits from ParameterListener
     void parameterChanged(Z::ParameterBase *param) override;
 
+    // inherits from ParamPropagator
+    void sourceChanged(Z::ParameterBase *source) override;
+
+    /// Evaluates all parameters driven by the sources and reports changed elements.
+    void propagate(const Z::ParamGraph& graph, const QList<Z::ParameterBase*>& sources);
+
+    void lockTransactionMatrix(Element* elem);
+
+    /// Drops all pending changes of the object leaving the schema in the current transaction.
+    void forgetTransactionChanges(void* object, const QList<Z::ParameterBase*>& params);
+
     inline bool isValid(int index) const { return index >= 0 && index < _items.size(); }
 
     /// Remove links driving this elements' params
@@ -314,6 +412,28 @@ private:
     void shiftElement(int index, const std::function<int(int)> &getTargetIndex);
 };
 
+//------------------------------------------------------------------------------
+/**
+    Makes a schema transaction in the current scope.
+    Null schema is allowed, then the transaction does nothing.
+*/
+class SchemaTransaction
+{
+public:
+    SchemaTransaction(Schema* schema): _schema(schema)
+    {
+        if (_schema) _schema->beginTransaction();
+    }
+
+    ~SchemaTransaction()
+    {
+        if (_schema) _schema->commitTransaction();
+    }
+
+private:
+    Schema *_schema;
+};
+
 
 namespace Z {
 namespace Utils {
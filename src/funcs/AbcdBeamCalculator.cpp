@@ -5,6 +5,8 @@
 
 #include <QDebug>
 
+#include <cmath>
+
 static bool isReal(const Z::Complex& v)
 {
 #ifdef Q_OS_MAC
@@ -31,6 +33,15 @@ static bool isImag(const Z::Complex& v)
 #endif
 }
 
+// For real matrices `W^2 = k*B / sqrt(4 - (A+D)^2)`, it is negative when B is negative
+// (W is pure imaginary then and its magnitude is taken), and NaN when the system is unstable.
+// The same is for the half angle with C instead of B. There is no branching, so the loop can be vectorized.
+static void calcSizeReal(int size, const double* A, const double* D, const double* X, double k, double* res)
+{
+    for (int i = 0; i < size; i++)
+        res[i] = std::sqrt(std::fabs(k * X[i] / std::sqrt(4.0 - SQR(A[i] + D[i]))));
+}
+
 AbcdBeamCalculator::AbcdBeamCalculator(double lambdaSI)
 {
     _wavelenSI = lambdaSI;
@@ -78,3 +89,38 @@ Z::PointTS AbcdBeamCalculator::halfAngle(const Z::Matrix &mt, const Z::Matrix& m
 {
     return { halfAngle(mt, ior), halfAngle(ms, ior) };
 }
+
+void AbcdBeamCalculator::beamRadius(const Z::MatrixBatch& m, double ior, double* w) const
+{
+    if (!m.isReal())
+    {
+        for (int i = 0; i < m.size(); i++)
+            w[i] = beamRadius(m.at(i), ior);
+        return;
+    }
+    calcSizeReal(m.size(), m.A(), m.D(), m.B(), _wavelenSI/ior * M_1_PI * 2.0, w);
+}
+
+void AbcdBeamCalculator::frontRadius(const Z::MatrixBatch& m, double ior, double* r) const
+{
+    if (!m.isReal())
+    {
+        for (int i = 0; i < m.size(); i++)
+            r[i] = frontRadius(m.at(i), ior);
+        return;
+    }
+    const double *A = m.A(), *B = m.B(), *D = m.D();
+    for (int i = 0; i < m.size(); i++)
+        r[i] = 2.0 * B[i] / (D[i] - A[i]);
+}
+
+void AbcdBeamCalculator::halfAngle(const Z::MatrixBatch& m, double ior, double* v) const
+{
+    if (!m.isReal())
+    {
+        for (int i = 0; i < m.size(); i++)
+            v[i] = halfAngle(m.at(i), ior);
+        return;
+    }
+    calcSizeReal(m.size(), m.A(), m.D(), m.C(), _wavelenSI/ior * M_1_PI * 2.0, v);
+}
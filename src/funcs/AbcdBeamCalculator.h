@@ -5,6 +5,7 @@
 
 namespace Z {
 class Matrix;
+class MatrixBatch;
 } // namespace Z
 
 class AbcdBeamCalculator
@@ -20,6 +21,12 @@ public:
     Z::PointTS frontRadius(const Z::Matrix &mt, const Z::Matrix& ms, double ior) const;
     Z::PointTS halfAngle(const Z::Matrix &mt, const Z::Matrix& ms, double ior) const;
 
+    /// Calculate the same values for each matrix of the batch and write them
+    /// to an array having at least the size of the batch.
+    void beamRadius(const Z::MatrixBatch& m, double ior, double* w) const;
+    void frontRadius(const Z::MatrixBatch& m, double ior, double* r) const;
+    void halfAngle(const Z::MatrixBatch& m, double ior, double* v) const;
+
 private:
     double _wavelenSI;
 };
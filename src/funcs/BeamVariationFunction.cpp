@@ -4,6 +4,7 @@
 #include "PumpCalculator.h"
 #include "RoundTripCalculator.h"
 #include "AbcdBeamCalculator.h"
+#include "EvalContext.h"
 
 void BeamVariationFunction::calculate()
 {
@@ -34,31 +35,66 @@ void BeamVariationFunction::calculate()
             : prepareResonator();
     if (!prepared) return;
 
+    if (takeCachedResults()) return;
+
     auto param = arg()->parameter;
     auto elem = arg()->element;
 
-    ElementEventsLocker elemLock(elem);
-    Z::ParamValueBackup paramLock(param);
+    _calc->multMatrix();
 
-    for (auto x : range.values())
+    // Parameter is varied in a copy of the schema, the schema itself stays untouched
+    EvalContext context(_schema);
+    RoundTripCalculator calc(context.schema(), context.element(_pos.element));
+    calc.calcRoundTrip(true);
+    auto contextRange = Z::Utils::asRange(context.element(_pos.element));
+    if (contextRange)
+        contextRange->setSubRangeSI(_pos.offset.toSi());
+    calc.setVariedElements({context.element(elem)});
+
+    auto values = range.values();
+    Z::MatrixBatch mt, ms;
+    mt.reserve(values.size());
+    ms.reserve(values.size());
+    for (auto x : values)
     {
         auto value = Z::Value(x, range.unit());
 
-        param->setValue(value);
-        _calc->multMatrix();
+        context.setParamValue(param, value);
+        calc.multMatrix();
 
-        Z::PointTS res;
-        switch (tripType)
+        mt.append(calc.Mt());
+        ms.append(calc.Ms());
+    }
+
+    // Beam is calculated for all the points at once
+    QVector<double> wt(values.size()), ws(values.size());
+    switch (tripType)
+    {
+    case TripType::SW:
+    case TripType::RR:
+        _beamCalc->beamRadius(mt, _ior, wt.data());
+        _beamCalc->beamRadius(ms, _ior, ws.data());
+        break;
+    case TripType::SP:
         {
-        case TripType::SW:
-        case TripType::RR: res = calculateResonator(); break;
-        case TripType::SP: res = calculateSinglePass(); break;
+            // Pump calculator gives all beam parameters, only radius is needed here
+            QVector<double> r(values.size()), v(values.size());
+            _pumpCalc.T->calc(mt, _ior, wt.data(), r.data(), v.data());
+            _pumpCalc.S->calc(ms, _ior, ws.data(), r.data(), v.data());
         }
-
-        addResultPoint(x, res);
+        break;
     }
 
+    for (int i = 0; i < values.size(); i++)
+        addResultPoint(values.at(i), wt.at(i), ws.at(i));
+
     finishResults();
+    cacheResults();
+}
+
+void BeamVariationFunction::addCacheKeyOptions(ResultCache::Key& key) const
+{
+    key << _schema->indexOf(_pos.element) << _pos.offset;
 }
 
 Z::PointTS BeamVariationFunction::calculateAt(const Z::Value& v)
@@ -75,8 +111,8 @@ Z::PointTS BeamVariationFunction::calculateAt(const Z::Value& v)
     switch (_schema->tripType())
     {
     case TripType::SW:
-    case TripType::RR: return calculateResonator();
-    case TripType::SP: return calculateSinglePass();
+    case TripType::RR: return calculateResonator(_calc);
+    case TripType::SP: return calculateSinglePass(_calc);
     }
     return { Double::nan(), Double::nan() };
 }
@@ -108,14 +144,14 @@ bool BeamVariationFunction::prepareResonator()
     return true;
 }
 
-Z::PointTS BeamVariationFunction::calculateSinglePass() const
+Z::PointTS BeamVariationFunction::calculateSinglePass(const RoundTripCalculator* calc) const
 {
-    BeamResult beamT = _pumpCalc.T->calc(_calc->Mt(), _ior);
-    BeamResult beamS = _pumpCalc.S->calc(_calc->Ms(), _ior);
+    BeamResult beamT = _pumpCalc.T->calc(calc->Mt(), _ior);
+    BeamResult beamS = _pumpCalc.S->calc(calc->Ms(), _ior);
     return { beamT.beamRadius, beamS.beamRadius };
 }
 
-Z::PointTS BeamVariationFunction::calculateResonator() const
+Z::PointTS BeamVariationFunction::calculateResonator(const RoundTripCalculator* calc) const
 {
-    return _beamCalc->beamRadius(_calc->Mt(), _calc->Ms(), _ior);
+    return _beamCalc->beamRadius(calc->Mt(), calc->Ms(), _ior);
 }
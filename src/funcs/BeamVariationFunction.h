@@ -32,10 +32,11 @@ protected:
     Z::PairTS<std::shared_ptr<PumpCalculator>> _pumpCalc;
     std::shared_ptr<AbcdBeamCalculator> _beamCalc;
 
+    void addCacheKeyOptions(ResultCache::Key& key) const override;
     bool prepareSinglePass();
     bool prepareResonator();
-    inline Z::PointTS calculateSinglePass() const;
-    inline Z::PointTS calculateResonator() const;
+    inline Z::PointTS calculateSinglePass(const RoundTripCalculator* calc) const;
+    inline Z::PointTS calculateResonator(const RoundTripCalculator* calc) const;
 };
 
 #endif // BEAM_VARIATION_FUNCTION_H
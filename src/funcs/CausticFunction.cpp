@@ -10,34 +10,177 @@
 #include <QApplication>
 #include <QDebug>
 
+namespace {
+
+// Beam inside a homogeneous range propagates as in free space,
+// so its parameter q at the offset `x` is q(0) + x. The same in terms of matrices
+// is `M(x) = T(x) * M(0) * T(x)^-1` for round-trip, and `M(x) = T(x) * M(0)`
+// for matrix of single-pass system, where `T(x) = [1 x; 0 1]`.
+
+inline Z::Matrix shiftRoundTrip(const Z::Matrix& m, double x)
+{
+    return Z::Matrix(m.A + x*m.C, m.B + x*(m.D - m.A) - x*x*m.C, m.C, m.D - x*m.C);
+}
+
+inline Z::Matrix shiftSinglePass(const Z::Matrix& m, double x)
+{
+    return Z::Matrix(m.A + x*m.C, m.B + x*m.D, m.C, m.D);
+}
+
+} // namespace
+
 void CausticFunction::calculate()
 {
-    if (!checkArgElem()) return;
+    Z::PlottingRange range;
+    auto elem = prepareCalculation(range);
+    if (!elem) return;
+
+    if (takeCachedResults()) return;
+
+    // Otherwise only sub-range matrices of the element change during the loop
+    if (!_homogeneous)
+        _calc->setVariedElements({elem});
+
+    QVector<Sample> samples;
+    if (adaptive())
+    {
+        auto calcBeamParams = _schema->isResonator()
+                ? &CausticFunction::calculateResonator
+                : &CausticFunction::calculateSinglePass;
+
+        samples = samplePoints(range, [&](double x){
+            Z::Matrix mt, ms;
+            calcMatricesAt(elem, x, mt, ms);
+            return (this->*calcBeamParams)(mt, ms);
+        });
+    }
+    else
+    {
+        // Points are known in advance, so matrices of all of them
+        // are calculated first and then beam is calculated for the whole batch
+        auto values = range.values();
+        Z::MatrixBatch mt, ms;
+        calcMatrices(elem, values, mt, ms);
+        samples = calculateBatch(values, _pumpCalc, mt, ms);
+    }
+    addSamples(samples, _results);
+
+    _calc->resetVariedElements();
+
+    finishResults();
+    cacheResults();
+}
+
+QVector<CausticFunction::PumpResults> CausticFunction::calculatePumps(const QList<PumpParams*>& pumps)
+{
+    QVector<PumpResults> pumpResults;
+    if (pumps.isEmpty()) return pumpResults;
+
+    // Pump independent checks are done for the first pump,
+    // if something is wrong, let each pump give its own error
+    setPump(pumps.first());
+    Z::PlottingRange range;
+    auto elem = _schema->isSP() && !adaptive() ? prepareCalculation(range) : nullptr;
+
+    // Dynamic elements are prepared from a beam of particular pump
+    bool hasDynamicElems = false;
+    if (elem)
+        for (auto e : _calc->matrixOwners())
+            if (dynamic_cast<ElementDynamic*>(e))
+            {
+                hasDynamicElems = true;
+                break;
+            }
+
+    if (!elem || hasDynamicElems)
+    {
+        for (auto pump : pumps)
+        {
+            setPump(pump);
+            calculate();
+            pumpResults.append({pump, errorText(), _results});
+        }
+        return pumpResults;
+    }
+
+    auto values = range.values();
+    Z::MatrixBatch mt, ms;
+    if (!_homogeneous)
+        _calc->setVariedElements({elem});
+    calcMatrices(elem, values, mt, ms);
+    _calc->resetVariedElements();
+    bool isReal = mt.at(0).isReal() and ms.at(0).isReal();
+
+    // Pump calculators read pump parameters, so they are prepared in the schema's thread
+    QVector<Z::PairTS<std::shared_ptr<PumpCalculator>>> pumpCalcs(pumps.size());
+    for (int i = 0; i < pumps.size(); i++)
+    {
+        auto pump = pumps.at(i);
+        QString error = FunctionUtils::preparePumpCalculator(schema(), pump, pumpCalcs[i]);
+        if (error.isEmpty() and Pumps::isGeometric(pump) and not isReal)
+            error = qApp->translate("Calc error", "Geometric pump can't be used with complex matrices");
+        pumpResults.append({pump, error, _results});
+    }
+
+    // Only samples are calculated in workers, they are added to results in this thread
+    // because results can report segments to the protocol which is shown in GUI
+    QVector<QVector<Sample>> pumpSamples(pumps.size());
+    std::atomic<bool> cancelled(false);
+    int threadCount = FunctionUtils::calcThreadCount(pumps.size());
+    FunctionUtils::calcParallel(pumps.size(), threadCount, cancelled, [&](int, int i){
+        if (!pumpResults.at(i).error.isEmpty()) return;
+        pumpSamples[i] = calculateBatch(values, pumpCalcs.at(i), mt, ms);
+    });
+    for (int i = 0; i < pumps.size(); i++)
+        if (pumpResults.at(i).error.isEmpty())
+            addSamples(pumpSamples.at(i), pumpResults[i].results);
+
+    for (auto& res : pumpResults)
+        if (res.error.isEmpty() && res.results.T.allPointsCount() == 0 && res.results.S.allPointsCount() == 0)
+            res.error = qApp->translate("Calc error", "No one valid point was calculated");
+
+    setPumpResults(pumpResults.last());
+    return pumpResults;
+}
+
+void CausticFunction::setPumpResults(const PumpResults& pumpResults)
+{
+    setPump(pumpResults.pump);
+    setError(QString());
+    _results = pumpResults.results;
+    if (pumpResults.error.isEmpty())
+    {
+        if (_schema->isSP())
+            prepareSinglePass(arg()->element);
+    }
+    else setError(pumpResults.error);
+}
+
+ElementRange* CausticFunction::prepareCalculation(Z::PlottingRange& range)
+{
+    if (!checkArgElem()) return nullptr;
 
     auto elem = Z::Utils::asRange(arg()->element);
     if (!elem)
     {
         setError("CausticFunction.arg.element is not range");
-        return;
+        return nullptr;
     }
 
     _ior = elem->ior();
+    _homogeneous = false;
 
     auto tmpRange = arg()->range;
     tmpRange.stop = Z::Value(elem->axisLengthSI(), Z::Units::m());
-    auto range = tmpRange.plottingRange();
-    if (!prepareResults(range)) return;
-    if (!prepareCalculator(elem, true)) return;
+    range = tmpRange.plottingRange();
+    if (!prepareResults(range)) return nullptr;
+    if (!prepareCalculator(elem, true)) return nullptr;
 
     bool isResonator = _schema->isResonator();
     bool isPrepared = isResonator
             ? prepareResonator()
             : prepareSinglePass(elem);
-    if (!isPrepared) return;
-
-    auto calcBeamParams = isResonator
-            ? &CausticFunction::calculateResonator
-            : &CausticFunction::calculateSinglePass;
+    if (!isPrepared) return nullptr;
 
     // Calculate round-trip matrix and check if the caustic can be calculated
     elem->setSubRangeSI(range.values().first());
@@ -48,44 +191,56 @@ void CausticFunction::calculate()
         if (not stab.T and not stab.S)
         {
             setError(qApp->translate("Calc error", "System is unstable, can't calculate caustic"));
-            return;
+            return nullptr;
         }
     }
     // Caustic can't be calculated for SP-system with geometric pump and complex matrices
     else if (Pumps::isGeometric(_pump) and (not _calc->Mt().isReal() or not _calc->Ms().isReal()))
     {
         setError(qApp->translate("Calc error", "Geometric pump can't be used with complex matrices"));
-        return;
+        return nullptr;
     }
 
-    Z::PointTS prevRes(Double::nan(), Double::nan());
-    for (auto x : range.values())
+    // In a homogeneous range it's enough to get matrices at the range origin only,
+    // all other points are calculated from them in closed form.
+    _homogeneous = elem->isHomogeneous();
+    if (_homogeneous)
     {
-        elem->setSubRangeSI(x);
+        elem->setSubRangeSI(0);
         _calc->multMatrix();
+        _mt0 = _calc->Mt();
+        _ms0 = _calc->Ms();
+    }
 
-        if (_writeProtocol)
-        {
-            Z_INFO("Offset" << x)
-            Z_INFO("Mt =" << _calc->Mt().str() << "| Ms =" << _calc->Ms().str())
-        }
+    return elem;
+}
 
-        Z::PointTS res = (this->*calcBeamParams)();
+void CausticFunction::addSamples(const QVector<Sample>& samples, Z::PairTS<PlotFuncResultSet>& results) const
+{
+    Z::PointTS prevRes(Double::nan(), Double::nan());
+    for (const Sample& sample : samples)
+    {
+        double x = sample.x;
+        const Z::PointTS& res = sample.y;
 
         if (_mode == FrontRadius)
         {
             // If wavefront radius changes its sign, then we have a pole at waist
             if (!std::isnan(prevRes.T) && (prevRes.T * res.T) < 0)
-                _results.T.addPoint(x, Double::nan()); // finish previous segment
+                results.T.addPoint(x, Double::nan()); // finish previous segment
             if (!std::isnan(prevRes.S) && (prevRes.S * res.S) < 0)
-                _results.S.addPoint(x, Double::nan()); // finish previous segment
+                results.S.addPoint(x, Double::nan()); // finish previous segment
             prevRes = res;
         }
 
-        addResultPoint(x, res);
+        results.T.addPoint(x, res.T);
+        results.S.addPoint(x, res.S);
     }
+}
 
-    finishResults();
+void CausticFunction::addCacheKeyOptions(ResultCache::Key& key) const
+{
+    key << int(_mode) << _pump;
 }
 
 bool CausticFunction::prepareSinglePass(Element* ref)
@@ -107,10 +262,92 @@ bool CausticFunction::prepareResonator()
     return true;
 }
 
-Z::PointTS CausticFunction::calculateSinglePass() const
+void CausticFunction::calcMatricesAt(ElementRange* elem, double x, Z::Matrix& mt, Z::Matrix& ms)
+{
+    if (_homogeneous)
+    {
+        auto shiftMatrix = _schema->isResonator() ? shiftRoundTrip : shiftSinglePass;
+        mt = shiftMatrix(_mt0, x);
+        ms = shiftMatrix(_ms0, x);
+        return;
+    }
+    elem->setSubRangeSI(x);
+    _calc->multMatrix();
+    mt = _calc->Mt();
+    ms = _calc->Ms();
+}
+
+void CausticFunction::calcMatrices(ElementRange* elem, const QVector<double>& values, Z::MatrixBatch& mt, Z::MatrixBatch& ms)
 {
-    BeamResult beamT = _pumpCalc.T->calc(_calc->Mt(), _ior);
-    BeamResult beamS = _pumpCalc.S->calc(_calc->Ms(), _ior);
+    mt.clear();
+    ms.clear();
+    mt.reserve(values.size());
+    ms.reserve(values.size());
+    Z::Matrix m1, m2;
+    for (auto x : values)
+    {
+        calcMatricesAt(elem, x, m1, m2);
+
+        if (_writeProtocol)
+        {
+            Z_INFO("Offset" << x)
+            Z_INFO("Mt =" << m1.str() << "| Ms =" << m2.str())
+        }
+
+        mt.append(m1);
+        ms.append(m2);
+    }
+}
+
+QVector<PlotFunction::Sample> CausticFunction::calculateBatch(const QVector<double>& values,
+    const Z::PairTS<std::shared_ptr<PumpCalculator>>& pumpCalc, const Z::MatrixBatch& mt, const Z::MatrixBatch& ms) const
+{
+    int size = values.size();
+    QVector<double> yt(size), ys(size);
+    if (_schema->isResonator())
+    {
+        switch (_mode)
+        {
+        case BeamRadius:
+            _beamCalc->beamRadius(mt, _ior, yt.data());
+            _beamCalc->beamRadius(ms, _ior, ys.data());
+            break;
+        case FrontRadius:
+            _beamCalc->frontRadius(mt, _ior, yt.data());
+            _beamCalc->frontRadius(ms, _ior, ys.data());
+            break;
+        case HalfAngle:
+            _beamCalc->halfAngle(mt, _ior, yt.data());
+            _beamCalc->halfAngle(ms, _ior, ys.data());
+            break;
+        }
+    }
+    else
+    {
+        // Pump calculator gives all beam parameters at once, only those of the mode are taken
+        QVector<double> tmp1(size), tmp2(size);
+        auto calcPump = [&](PumpCalculator* calc, const Z::MatrixBatch& m, double* y) {
+            switch (_mode)
+            {
+            case BeamRadius: calc->calc(m, _ior, y, tmp1.data(), tmp2.data()); break;
+            case FrontRadius: calc->calc(m, _ior, tmp1.data(), y, tmp2.data()); break;
+            case HalfAngle: calc->calc(m, _ior, tmp1.data(), tmp2.data(), y); break;
+            }
+        };
+        calcPump(pumpCalc.T.get(), mt, yt.data());
+        calcPump(pumpCalc.S.get(), ms, ys.data());
+    }
+
+    QVector<Sample> samples(size);
+    for (int i = 0; i < size; i++)
+        samples[i] = {values.at(i), {yt.at(i), ys.at(i)}};
+    return samples;
+}
+
+Z::PointTS CausticFunction::calculateSinglePass(const Z::Matrix& mt, const Z::Matrix& ms) const
+{
+    BeamResult beamT = _pumpCalc.T->calc(mt, _ior);
+    BeamResult beamS = _pumpCalc.S->calc(ms, _ior);
     switch (_mode)
     {
     case BeamRadius: return { beamT.beamRadius, beamS.beamRadius };
@@ -121,13 +358,13 @@ Z::PointTS CausticFunction::calculateSinglePass() const
     return { Double::nan(), Double::nan() };
 }
 
-Z::PointTS CausticFunction::calculateResonator() const
+Z::PointTS CausticFunction::calculateResonator(const Z::Matrix& mt, const Z::Matrix& ms) const
 {
     switch (_mode)
     {
-    case BeamRadius: return _beamCalc->beamRadius(_calc->Mt(), _calc->Ms(), _ior);
-    case FrontRadius: return _beamCalc->frontRadius(_calc->Mt(), _calc->Ms(), _ior);
-    case HalfAngle: return _beamCalc->halfAngle(_calc->Mt(), _calc->Ms(), _ior);
+    case BeamRadius: return _beamCalc->beamRadius(mt, ms, _ior);
+    case FrontRadius: return _beamCalc->frontRadius(mt, ms, _ior);
+    case HalfAngle: return _beamCalc->halfAngle(mt, ms, _ior);
     }
     qCritical() << "Unsupported caustic result mode";
     return Z::PointTS();
@@ -140,9 +377,9 @@ Z::PointTS CausticFunction::calculateAt(double argSI)
     auto calcBeamParams = _schema->isResonator()
             ? &CausticFunction::calculateResonator
             : &CausticFunction::calculateSinglePass;
-    elem->setSubRangeSI(x);
-    _calc->multMatrix();
-    return (this->*calcBeamParams)();
+    Z::Matrix mt, ms;
+    calcMatricesAt(elem, x, mt, ms);
+    return (this->*calcBeamParams)(mt, ms);
 }
 
 QString CausticFunction::modeAlias(Mode mode)
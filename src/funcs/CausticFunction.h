@@ -25,6 +25,25 @@ public:
     // Only needs for SP schemas
     void setPump(PumpParams* pump) { _pump = pump; }
 
+    /// Results of the function calculated for one of pumps, see @ref calculatePumps().
+    struct PumpResults
+    {
+        PumpParams* pump;
+        QString error;
+        Z::PairTS<PlotFuncResultSet> results;
+    };
+
+    /// Calculates the function for each of given pumps of SP schema.
+    /// Round-trip matrices do not depend on pump, so they are calculated once
+    /// and only beam parameters are calculated for every pump, pumps are processed in parallel.
+    /// When the round-trip includes dynamic elements or adaptive sampling is enabled,
+    /// matrices depend on pump and the function is calculated for each pump separately.
+    QVector<PumpResults> calculatePumps(const QList<PumpParams*>& pumps);
+
+    /// Makes results calculated by @ref calculatePumps() to be results of the function
+    /// and selects their pump, so @ref calculateAt() gives points of the same beam.
+    void setPumpResults(const PumpResults& pumpResults);
+
     Z::PointTS calculateAt(double argSI);
 
     void calculate() override;
@@ -48,10 +67,22 @@ private:
     std::shared_ptr<AbcdBeamCalculator> _beamCalc;
     bool _writeProtocol = false;
 
+    /// Matrices at the origin of a homogeneous range,
+    /// beam at other points of the range is calculated from them in closed form.
+    bool _homogeneous = false;
+    Z::Matrix _mt0, _ms0;
+
+    void addCacheKeyOptions(ResultCache::Key& key) const override;
+    ElementRange* prepareCalculation(Z::PlottingRange& range);
     bool prepareSinglePass(Element *ref);
     bool prepareResonator();
-    inline Z::PointTS calculateSinglePass() const;
-    inline Z::PointTS calculateResonator() const;
+    void calcMatricesAt(ElementRange* elem, double x, Z::Matrix& mt, Z::Matrix& ms);
+    void calcMatrices(ElementRange* elem, const QVector<double>& values, Z::MatrixBatch& mt, Z::MatrixBatch& ms);
+    QVector<Sample> calculateBatch(const QVector<double>& values, const Z::PairTS<std::shared_ptr<PumpCalculator>>& pumpCalc,
+                                   const Z::MatrixBatch& mt, const Z::MatrixBatch& ms) const;
+    void addSamples(const QVector<Sample>& samples, Z::PairTS<PlotFuncResultSet>& results) const;
+    inline Z::PointTS calculateSinglePass(const Z::Matrix& mt, const Z::Matrix& ms) const;
+    inline Z::PointTS calculateResonator(const Z::Matrix& mt, const Z::Matrix& ms) const;
 };
 
 #endif // CAUSTIC_FUNCTION_H
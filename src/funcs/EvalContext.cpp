@@ -0,0 +1,72 @@
+#include "EvalContext.h"
+
+#include "../core/ElementFormula.h"
+#include "../core/ElementsCatalog.h"
+#include "../core/Schema.h"
+
+static Element* cloneElement(Element* source)
+{
+    Element* elem;
+
+    // Formula elements are not in the catalog and have custom set of params
+    auto formula = dynamic_cast<ElemFormula*>(source);
+    if (formula)
+    {
+        auto elemFormula = new ElemFormula;
+        elemFormula->assign(formula);
+        elem = elemFormula;
+    }
+    else
+        elem = ElementsCatalog::instance().create(source, true);
+
+    if (!elem) return nullptr;
+
+    elem->setLabel(source->label());
+    elem->setTitle(source->title());
+    elem->setDisabled(source->disabled());
+    elem->calcMatrix("EvalContext: clone element");
+    return elem;
+}
+
+EvalContext::EvalContext(Schema* source) : _source(source)
+{
+    _schema.reset(new Schema);
+
+    // Context schema has no listeners, but it still writes events into the protocol,
+    // that is not allowed when calculations in the context are run in worker threads
+    _schema->events().disable();
+
+    _schema->setTripType(source->tripType());
+    _schema->wavelength().setValue(source->wavelength().value());
+
+    Elements elems;
+    for (auto sourceElem : source->elements())
+    {
+        auto elem = cloneElement(sourceElem);
+        if (!elem)
+        {
+            qWarning() << "EvalContext: unable to clone element" << sourceElem->type();
+            continue;
+        }
+        elems << elem;
+        _elems.insert(sourceElem, elem);
+        auto sourceParams = sourceElem->params();
+        auto params = elem->params();
+        for (int i = 0; i < sourceParams.size() && i < params.size(); i++)
+            _params.insert(sourceParams.at(i), params.at(i));
+    }
+    _schema->insertElements(elems, -1, Arg::RaiseEvents(false));
+}
+
+EvalContext::~EvalContext()
+{
+}
+
+void EvalContext::setParamValue(Z::Parameter* sourceParam, const Z::Value& value)
+{
+    auto param = _params.value(sourceParam);
+    if (param)
+        param->setValue(value);
+    else
+        qWarning() << "EvalContext: unknown parameter" << sourceParam->alias();
+}
@@ -0,0 +1,54 @@
+#ifndef EVAL_CONTEXT_H
+#define EVAL_CONTEXT_H
+
+#include "../core/Parameters.h"
+
+#include <QHash>
+
+#include <memory>
+
+class Element;
+class Schema;
+
+/**
+    Isolated copy of schema elements for side-effect-free calculations.
+
+    The context clones all elements of a schema, together with their parameter values,
+    into its own private schema. Functions can then override parameter values and recalculate
+    element matrices in the context without changing the source schema, raising its events,
+    or blocking other functions using the same schema. Contexts don't share anything,
+    so different contexts can be used in different threads at the same time.
+
+    The context must be created in the thread owning the source schema,
+    and it doesn't track changes made in the source schema after creation.
+*/
+class EvalContext
+{
+public:
+    EvalContext(Schema* source);
+    ~EvalContext();
+
+    Schema* source() const { return _source; }
+
+    /// The private schema containing copies of source elements.
+    Schema* schema() const { return _schema.get(); }
+
+    /// Returns a copy of the source element or null if the element is not from the source schema.
+    Element* element(Element* sourceElem) const { return _elems.value(sourceElem); }
+
+    /// Returns a copy of the source element's parameter or null if it's unknown.
+    Z::Parameter* param(Z::Parameter* sourceParam) const { return _params.value(sourceParam); }
+
+    /// Assigns a new value to the copy of the source parameter.
+    /// The matrix of the element owning the parameter is recalculated,
+    /// while the source parameter and element stay untouched.
+    void setParamValue(Z::Parameter* sourceParam, const Z::Value& value);
+
+private:
+    Schema* _source;
+    std::unique_ptr<Schema> _schema;
+    QHash<Element*, Element*> _elems;
+    QHash<Z::Parameter*, Z::Parameter*> _params;
+};
+
+#endif // EVAL_CONTEXT_H
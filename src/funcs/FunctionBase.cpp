@@ -1,6 +1,24 @@
 #include "FunctionBase.h"
 #include "../core/Schema.h"
 
+//------------------------------------------------------------------------------
+//                               FunctionInputs
+//------------------------------------------------------------------------------
+
+bool FunctionInputs::isAffectedBy(const SchemaChanges& changes) const
+{
+    if (changes.all) return true;
+    if (pump && changes.pump) return true;
+    if (wavelength && changes.wavelength) return true;
+    if (globalParams && !changes.params.isEmpty()) return true;
+    if (changes.elements.isEmpty()) return false;
+    if (allElements) return true;
+    for (auto elem : changes.elements)
+        if (elements.contains(elem))
+            return true;
+    return false;
+}
+
 //------------------------------------------------------------------------------
 //                               FunctionListener
 //------------------------------------------------------------------------------
@@ -19,6 +19,25 @@
 class FunctionBase;
 class RoundTripCalculator;
 class Schema;
+struct SchemaChanges;
+
+/**
+    Schema inputs which results of a function are calculated from.
+    When a global parameter drives an element parameter via link or formula,
+    the element gets changed too, so functions don't need to depend
+    on global parameters to see such changes.
+*/
+struct FunctionInputs
+{
+    bool allElements = true; ///< Function depends on all elements, @a elements is not used
+    Elements elements;       ///< Elements function depends on, e.g. elements of its round-trip
+    bool pump = true;        ///< Function depends on pumps
+    bool wavelength = true;  ///< Function depends on the schema wavelength
+    bool globalParams = true; ///< Function depends on values of global parameters directly
+
+    /// Returns true if the changes make results calculated from these inputs obsolete.
+    bool isAffectedBy(const SchemaChanges& changes) const;
+};
 
 class FunctionListener
 {
@@ -53,6 +72,13 @@ public:
 
     virtual QString helpTopic() const { return QString(); }
 
+    /// Returns schema inputs the function depends on.
+    /// By default, function depends on everything in the schema.
+    virtual FunctionInputs inputs() const { return FunctionInputs(); }
+
+    /// Returns true if the function has to be recalculated after the schema changes.
+    bool isAffectedBy(const SchemaChanges& changes) const { return inputs().isAffectedBy(changes); }
+
 protected:
     Schema *_schema;
 
@@ -73,6 +99,14 @@ public:
     void calculate();
     void freeze(bool on);
     bool frozen() const { return _frozen; }
+
+    /// Is called with the schema changes the function is affected by before its recalculation.
+    /// Changes come in several portions when the function is frozen between recalculations.
+    virtual void collectChanges(const SchemaChanges&) {}
+
+    /// Is called when the schema could be changed in unknown way,
+    /// so the next calculation can't rely on previously collected changes.
+    virtual void resetChanges() {}
 protected:
     InfoFunction(Schema *schema) : FunctionBase(schema) {}
     virtual QString calculateInternal() { return QString(); }
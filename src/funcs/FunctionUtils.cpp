@@ -1,10 +1,15 @@
 #include "FunctionUtils.h"
 
 #include "PumpCalculator.h"
-#include "RoundTripCalculator.h"
+#include "../AppSettings.h"
 #include "../core/Schema.h"
 #include "../core/Elements.h"
 
+#include <QThread>
+
+#include <thread>
+#include <vector>
+
 namespace FunctionUtils {
 
 QString preparePumpCalculator(Schema* schema,
@@ -32,43 +37,64 @@ QString preparePumpCalculator(Schema* schema,
 
 void prepareDynamicElements(Schema* schema, Element* stopElem, const Z::PairTS<std::shared_ptr<PumpCalculator>>& pumpCalc)
 {
+    // Matrices of part of the schema from the first element up to the current one (not including).
+    // They are the same as RoundTripCalculator gives for SP schema when the previous element
+    // is the reference, but are accumulated in a single pass instead of a round-trip per element.
+    Z::Matrix mt, ms;
+    Element* prevElem = nullptr;
     for (int i = 0; i < schema->count(); i++)
     {
         auto elem = schema->element(i);
         if (elem == stopElem) break;
-        auto dynamic = dynamic_cast<ElementDynamic*>(elem);
-        if (!dynamic) continue;
 
-        if (i == 0)
+        auto dynamic = dynamic_cast<ElementDynamic*>(elem);
+        if (dynamic)
         {
-            Z::Matrix unity;
             ElementDynamic::CalcParams p;
-            p.Mt = &unity;
-            p.Ms = &unity;
+            p.Mt = &mt;
+            p.Ms = &ms;
             p.pumpCalcT = pumpCalc.T.get();
             p.pumpCalcS = pumpCalc.S.get();
+            auto medium = dynamic_cast<ElemMediumRange*>(prevElem);
+            p.prevElemIor = medium ? medium->ior() : 1;
             p.schemaWavelenSi = schema->wavelenSi();
-            p.prevElemIor = 1;
             dynamic->calcDynamicMatrix(p);
+
+            mt = dynamic->Mt_dyn() * mt;
+            ms = dynamic->Ms_dyn() * ms;
         }
         else
         {
-            auto prevElem = schema->element(i - i);
-            RoundTripCalculator calc(schema, prevElem);
-            calc.calcRoundTrip();
-            calc.multMatrix();
-            ElementDynamic::CalcParams p;
-            p.Mt = calc.pMt();
-            p.Ms = calc.pMs();
-            p.pumpCalcT = pumpCalc.T.get();
-            p.pumpCalcS = pumpCalc.S.get();
-            auto medium = dynamic_cast<ElemMediumRange*>(prevElem);
-            p.prevElemIor = medium ? medium->ior() : 1;
-            p.schemaWavelenSi = schema->wavelenSi();
-            dynamic->calcDynamicMatrix(p);
+            mt = elem->Mt() * mt;
+            ms = elem->Ms() * ms;
         }
+        prevElem = elem;
     }
 }
 
+int calcThreadCount(int jobCount)
+{
+    int threadCount = AppSettings::instance().calcThreadCount;
+    if (threadCount <= 0)
+        threadCount = QThread::idealThreadCount();
+    return qBound(1, threadCount, jobCount);
+}
+
+void calcParallel(int jobCount, int threadCount, const std::atomic<bool>& cancelled,
+                  const std::function<void(int worker, int job)>& calcJob)
+{
+    std::atomic<int> nextJob(0);
+    auto work = [&](int worker) {
+        for (int job = nextJob++; job < jobCount && !cancelled; job = nextJob++)
+            calcJob(worker, job);
+    };
+    std::vector<std::thread> threads;
+    for (int worker = 1; worker < threadCount; worker++)
+        threads.emplace_back(work, worker);
+    work(0);
+    for (auto& thread : threads)
+        thread.join();
+}
+
 } // namespace FunctionUtils
 
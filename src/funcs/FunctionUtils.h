@@ -3,6 +3,8 @@
 
 #include "../core/Values.h"
 
+#include <atomic>
+#include <functional>
 #include <memory>
 
 class Element;
@@ -18,6 +20,15 @@ QString preparePumpCalculator(Schema* schema,
                               bool writeProtocol = false);
 void prepareDynamicElements(Schema* schema, Element* stopElem, const Z::PairTS<std::shared_ptr<PumpCalculator> > &pumpCalc);
 
+/// Returns the number of threads for a parallel calculation of `jobCount` independent jobs,
+/// as configured in application settings but not more than the jobs count.
+int calcThreadCount(int jobCount);
+
+/// Calls calcJob for each job index, jobs are distributed among threads dynamically.
+/// The first worker runs in the calling thread. Workers stop taking jobs when cancelled.
+void calcParallel(int jobCount, int threadCount, const std::atomic<bool>& cancelled,
+                  const std::function<void(int worker, int job)>& calcJob);
+
 } // namespace FunctionUtils
 
 #endif // FUNCTION_UTILS_H
@@ -22,6 +22,17 @@ FunctionBase::FunctionState InfoFuncMatrix::elementDeleting(Element *elem)
     return _element == elem? Frozen: Ok;
 }
 
+FunctionInputs InfoFuncMatrix::inputs() const
+{
+    FunctionInputs inputs;
+    inputs.allElements = false;
+    inputs.elements << _element;
+    inputs.pump = false;
+    inputs.wavelength = false;
+    inputs.globalParams = false;
+    return inputs;
+}
+
 QString InfoFuncMatrix::calculateInternal()
 {
     QString report = Z::Format::elementTitleAndMatrices(_element);
@@ -43,6 +54,17 @@ FunctionBase::FunctionState InfoFuncMatrices::elementDeleting(Element *elem)
     return _elements.isEmpty()? Dead: Ok;
 }
 
+FunctionInputs InfoFuncMatrices::inputs() const
+{
+    FunctionInputs inputs;
+    inputs.allElements = false;
+    inputs.elements = _elements;
+    inputs.pump = false;
+    inputs.wavelength = false;
+    inputs.globalParams = false;
+    return inputs;
+}
+
 QString InfoFuncMatrices::calculateInternal()
 {
     QString result;
@@ -110,15 +132,39 @@ InfoFuncMatrixRT::InfoFuncMatrixRT(Schema *schema, Element *elem)
 
 FunctionBase::FunctionState InfoFuncMatrixRT::elementDeleting(Element *elem)
 {
+    resetChanges();
     if (_schema->count() == 1) return Dead;
     return _element == elem? Frozen: Ok;
 }
 
+void InfoFuncMatrixRT::collectChanges(const SchemaChanges& changes)
+{
+    if (changes.all || changes.wavelength)
+    {
+        resetChanges();
+        return;
+    }
+    for (auto elem : changes.elements)
+        if (!_changedElems.contains(elem))
+            _changedElems << elem;
+}
+
+void InfoFuncMatrixRT::resetChanges()
+{
+    _calc.reset();
+    _changedElems.clear();
+}
+
 QString InfoFuncMatrixRT::calculateInternal()
 {
-    RoundTripCalculator c(_schema, _element);
-    c.calcRoundTrip();
-    c.multMatrix();
+    if (!_calc || !_calc->updateElements(_changedElems))
+    {
+        _calc.reset(new RoundTripCalculator(_schema, _element));
+        _calc->calcRoundTrip();
+        _calc->buildProductTree();
+    }
+    _changedElems.clear();
+    const RoundTripCalculator& c = *_calc;
 
     QString result;
     QTextStream report(&result);
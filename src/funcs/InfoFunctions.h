@@ -3,6 +3,8 @@
 
 #include <QApplication>
 
+#include <memory>
+
 #include "FunctionBase.h"
 #include "../core/Element.h"
 
@@ -16,6 +18,7 @@ public:
     InfoFuncMatrix(Schema*, Element*);
     QString calculateInternal() override;
     FunctionState elementDeleting(Element *elem) override;
+    FunctionInputs inputs() const override;
     FUNC_NAME(qApp->translate("Func", "Element's Matrices"))
 private:
     Element* _element;
@@ -29,6 +32,7 @@ public:
     InfoFuncMatrices(Schema*, const Elements&);
     QString calculateInternal() override;
     FunctionState elementDeleting(Element*) override;
+    FunctionInputs inputs() const override;
     FUNC_NAME(qApp->translate("Func", "Elements' Matrices"))
 protected:
     Elements _elements;
@@ -58,9 +62,17 @@ public:
     InfoFuncMatrixRT(Schema*, Element*);
     QString calculateInternal() override;
     FunctionState elementDeleting(Element*) override;
+    void collectChanges(const SchemaChanges& changes) override;
+    void resetChanges() override;
     FUNC_NAME(qApp->translate("Func", "Round-trip Matrix"))
 private:
     Element* _element;
+
+    // Calculator of the last calculation is kept between recalculations,
+    // then only matrices of changed elements are refreshed in its product trees
+    std::shared_ptr<RoundTripCalculator> _calc;
+    Elements _changedElems;
+
     QString formatStability(char plane, double value);
 };
 
@@ -1,5 +1,40 @@
 #include "MultibeamCausticFunction.h"
 
+#include <QApplication>
+
 MultibeamCausticFunction::MultibeamCausticFunction(Schema *schema) : MultirangeCausticFunction(schema)
 {
 }
+
+void MultibeamCausticFunction::calculatePumps(const QList<PumpParams*>& pumps)
+{
+    _pumps = pumps;
+    _pumpResults.clear();
+    for (auto func : funcs())
+        _pumpResults.append(func->calculatePumps(pumps));
+}
+
+bool MultibeamCausticFunction::selectPump(PumpParams* pump)
+{
+    int index = _pumps.indexOf(pump);
+    if (index < 0 || _pumpResults.size() != funcs().size())
+    {
+        setError(qApp->translate("Calc error", "Pump was not calculated"));
+        return false;
+    }
+
+    setError(QString());
+    for (int i = 0; i < funcs().size(); i++)
+    {
+        auto func = funcs().at(i);
+        func->setPumpResults(_pumpResults.at(i).at(index));
+        if (!func->ok())
+        {
+            setError(func->errorText());
+            for (auto f : funcs())
+                f->clearResults();
+            return false;
+        }
+    }
+    return true;
+}
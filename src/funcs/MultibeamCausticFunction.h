@@ -14,8 +14,21 @@ public:
 
     bool hasOptions() const override { return false; }
 
+    /// Calculates caustics of all given pumps, each range shares its matrices among pumps.
+    /// Then results of a particular pump are selected by @ref selectPump().
+    void calculatePumps(const QList<PumpParams*>& pumps);
+
+    /// Makes results of the pump calculated by @ref calculatePumps() to be the function's results.
+    /// Returns false if the pump was not calculated or there is an error calculating it.
+    bool selectPump(PumpParams* pump);
+
     CausticFunction::Mode mode() const = delete;
     void setMode(CausticFunction::Mode mode) = delete;
+
+private:
+    QList<PumpParams*> _pumps;
+    /// Results of each pump for each of range functions
+    QVector<QVector<CausticFunction::PumpResults>> _pumpResults;
 };
 
 #endif // MULTI_BEAM_CAUSTIC_FUNCTION_H
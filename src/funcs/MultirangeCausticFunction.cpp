@@ -51,6 +51,29 @@ void MultirangeCausticFunction::setArgs(const QVector<Z::Variable>& args)
     _funcs = funcs;
 }
 
+FunctionInputs MultirangeCausticFunction::inputs() const
+{
+    FunctionInputs inputs;
+    if (!ok() || _funcs.isEmpty()) return inputs;
+
+    inputs.allElements = false;
+    inputs.pump = false;
+    inputs.wavelength = false;
+    inputs.globalParams = false;
+    for (auto func : _funcs)
+    {
+        auto funcInputs = func->inputs();
+        if (funcInputs.allElements) return FunctionInputs();
+        for (auto elem : funcInputs.elements)
+            if (!inputs.elements.contains(elem))
+                inputs.elements << elem;
+        inputs.pump |= funcInputs.pump;
+        inputs.wavelength |= funcInputs.wavelength;
+        inputs.globalParams |= funcInputs.globalParams;
+    }
+    return inputs;
+}
+
 void MultirangeCausticFunction::calculate()
 {
     setError(QString());
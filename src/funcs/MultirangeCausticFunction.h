@@ -19,6 +19,7 @@ public:
     bool hasOptions() const override { return true; }
     int resultCount(Z::WorkPlane plane) const override;
     const PlotFuncResult& result(Z::WorkPlane plane, int index) const override;
+    FunctionInputs inputs() const override;
 
     // Only needs for SP schemas
     void setPump(PumpParams* pump);
@@ -0,0 +1,292 @@
+#include "OpticalProgram.h"
+
+#include "RoundTripCalculator.h"
+#include "../core/Elements.h"
+#include "../core/Schema.h"
+
+#include <math.h>
+
+// Right-side multiplication by matrices of particular shapes,
+// m *= [1 b; 0 1], m *= [1 0; c 1], and m *= [a 0; 0 d].
+
+static inline void multB(Z::RealMatrix& m, double b)
+{
+    m.B = m.A * b + m.B;
+    m.D = m.C * b + m.D;
+}
+
+static inline void multC(Z::RealMatrix& m, double c)
+{
+    m.A = m.A + m.B * c;
+    m.C = m.C + m.D * c;
+}
+
+static inline void multAD(Z::RealMatrix& m, double a, double d)
+{
+    m.A *= a;
+    m.B *= d;
+    m.C *= a;
+    m.D *= d;
+}
+
+bool OpticalProgram::compile(const RoundTripCalculator* calc, const QList<Element*>& variedElems)
+{
+    _ops.clear();
+    _slots.clear();
+    _slotIndex.clear();
+    _error.clear();
+
+    if (!calc->isReal())
+    {
+        _error = QStringLiteral("Round-trip is not real");
+        return false;
+    }
+
+    auto links = calc->owner()->paramLinks();
+    auto varied = calc->withLinkedElements(variedElems);
+    auto owners = calc->matrixOwners();
+    const auto& matrsT = calc->matrsT();
+    const auto& matrsS = calc->matrsS();
+
+    for (int i = 0; i < owners.size(); i++)
+    {
+        auto elem = owners.at(i);
+        // Disabled elements have unity matrices whatever their parameters are
+        if (!varied.contains(elem) || elem->disabled())
+        {
+            if (_ops.isEmpty() || _ops.last().code != OpConst)
+            {
+                Op op;
+                op.code = OpConst;
+                _ops << op;
+            }
+            _ops.last().mt *= matrsT.at(i);
+            _ops.last().ms *= matrsS.at(i);
+            continue;
+        }
+
+        bool inverse;
+        if (matrsT.at(i) == elem->pMt() && matrsS.at(i) == elem->pMs())
+            inverse = false;
+        else if (matrsT.at(i) == elem->pMt_inv() && matrsS.at(i) == elem->pMs_inv())
+            inverse = true;
+        else
+        {
+            // sub-ranges and dynamic matrices are not supported
+            _error = QString("Unsupported matrix of element %1").arg(elem->displayLabel());
+            return false;
+        }
+
+        if (!compileElement(elem, inverse, links))
+        {
+            _error = QString("Unsupported element %1 (%2)").arg(elem->displayLabel(), elem->type());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OpticalProgram::compileElement(Element* elem, bool inverse, Z::ParamLinks* links)
+{
+    auto type = elem->type();
+    auto params = elem->params();
+
+    Op op;
+    if (type == ElemEmptyRange::_type_() ||
+        type == ElemMediumRange::_type_())
+    {
+        op.code = OpRange;
+        op.arg1 = slotOf(params.byAlias("L"), links);
+    }
+    else if (type == ElemPlate::_type_())
+    {
+        op.code = OpPlate;
+        op.arg1 = slotOf(params.byAlias("L"), links);
+        op.arg2 = slotOf(params.byAlias("n"), links);
+    }
+    else if (type == ElemCurveMirror::_type_())
+    {
+        op.code = OpCurveMirror;
+        op.arg1 = slotOf(params.byAlias("R"), links);
+        op.arg2 = slotOf(params.byAlias("Alpha"), links);
+    }
+    else if (type == ElemThinLens::_type_() ||
+             type == ElemCylinderLensT::_type_() ||
+             type == ElemCylinderLensS::_type_())
+    {
+        op.code = type == ElemThinLens::_type_() ? OpThinLens :
+                  type == ElemCylinderLensT::_type_() ? OpCylinderLensT : OpCylinderLensS;
+        op.arg1 = slotOf(params.byAlias("F"), links);
+        op.arg2 = slotOf(params.byAlias("Alpha"), links);
+    }
+    else if (type == ElemNormalInterface::_type_() ||
+             type == ElemBrewsterInterface::_type_())
+    {
+        op.code = type == ElemNormalInterface::_type_() ? OpNormalInterface : OpBrewsterInterface;
+        // The inverse matrix of interface is the direct one with swapped media
+        op.arg1 = slotOf(params.byAlias(inverse ? "n2" : "n1"), links);
+        op.arg2 = slotOf(params.byAlias(inverse ? "n1" : "n2"), links);
+    }
+    else if (type == ElemFlatMirror::_type_() ||
+             type == ElemPoint::_type_())
+    {
+        // unity matrix, nothing to do
+        return true;
+    }
+    else return false;
+
+    if (op.arg1 < 0 || (op.code != OpRange && op.arg2 < 0))
+        return false;
+
+    _ops << op;
+    return true;
+}
+
+int OpticalProgram::slotOf(Z::Parameter* param, Z::ParamLinks* links)
+{
+    if (!param) return -1;
+
+    auto link = links->byTarget(param);
+    if (link)
+        return slotOf(link->source(), links);
+
+    int slot = _slotIndex.value(param, -1);
+    if (slot < 0)
+    {
+        slot = _slots.size();
+        _slots << param->value().toSi();
+        _slotIndex.insert(param, slot);
+    }
+    return slot;
+}
+
+void OpticalProgram::run()
+{
+    Z::RealMatrix mt, ms;
+    const double* slots = _slots.constData();
+    for (const Op& op : qAsConst(_ops))
+    {
+        switch (op.code)
+        {
+        case OpConst:
+            mt *= op.mt;
+            ms *= op.ms;
+            break;
+
+        case OpRange:
+            multB(mt, slots[op.arg1]);
+            multB(ms, slots[op.arg1]);
+            break;
+
+        case OpPlate:
+            multB(mt, slots[op.arg1] / slots[op.arg2]);
+            multB(ms, slots[op.arg1] / slots[op.arg2]);
+            break;
+
+        case OpCurveMirror:
+        {
+            const double cosAlpha = cos(slots[op.arg2]);
+            multC(mt, -2.0 / slots[op.arg1] / cosAlpha);
+            multC(ms, -2.0 / slots[op.arg1] * cosAlpha);
+            break;
+        }
+
+        case OpThinLens:
+        {
+            const double cosAlpha = cos(slots[op.arg2]);
+            multC(mt, -1.0 / slots[op.arg1] / cosAlpha);
+            multC(ms, -1.0 / slots[op.arg1] * cosAlpha);
+            break;
+        }
+
+        case OpCylinderLensT:
+            multC(mt, -1.0 / slots[op.arg1] / cos(slots[op.arg2]));
+            break;
+
+        case OpCylinderLensS:
+            multC(ms, -1.0 / slots[op.arg1] * cos(slots[op.arg2]));
+            break;
+
+        case OpNormalInterface:
+        {
+            const double n1 = slots[op.arg1];
+            const double n2 = slots[op.arg2];
+            multAD(mt, 1, n1 / n2);
+            multAD(ms, 1, n1 / n2);
+            break;
+        }
+
+        case OpBrewsterInterface:
+        {
+            const double n1 = slots[op.arg1];
+            const double n2 = slots[op.arg2];
+            multAD(mt, n2 / n1, (n1 / n2) * (n1 / n2));
+            multAD(ms, 1, n1 / n2);
+            break;
+        }
+        }
+    }
+    _realMt = mt;
+    _realMs = ms;
+    _mt.assign(mt.A, mt.B, mt.C, mt.D);
+    _ms.assign(ms.A, ms.B, ms.C, ms.D);
+}
+
+bool OpticalProgram::split(int slotX, int slotY, OpticalProgram& partX, OpticalProgram& partY) const
+{
+    // Which slot each operation depends on: 0 - none, 1 - X, 2 - Y
+    const int count = _ops.size();
+    QVector<int> deps(count);
+    for (int i = 0; i < count; i++)
+    {
+        const Op& op = _ops.at(i);
+        bool x = op.arg1 == slotX || op.arg2 == slotX;
+        bool y = op.arg1 == slotY || op.arg2 == slotY;
+        if (x && y) return false;
+        deps[i] = x ? 1 : (y ? 2 : 0);
+    }
+
+    // Count cyclic transitions between X and Y dependent operations,
+    // parts are separable when there are exactly two of them
+    int last = 0;
+    for (int i = count-1; i >= 0 && !last; i--)
+        last = deps.at(i);
+    int start = -1;
+    int changes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int dep = deps.at(i);
+        if (!dep || dep == last) continue;
+        if (dep == 1) start = i;
+        last = dep;
+        changes++;
+    }
+    if (changes != 2) return false;
+
+    partX._ops.clear();
+    partY._ops.clear();
+    bool inX = true;
+    for (int k = 0; k < count; k++)
+    {
+        int i = (start + k) % count;
+        if (deps.at(i) == 2) inX = false;
+        (inX ? partX : partY).append(_ops.at(i));
+    }
+    partX._slots = _slots;
+    partX._slotIndex = _slotIndex;
+    partY._slots = _slots;
+    partY._slotIndex = _slotIndex;
+    return true;
+}
+
+void OpticalProgram::append(const Op& op)
+{
+    // Products of consecutive constants can be joined, e.g. when the end of round-trip
+    // is followed by its beginning in a cyclically shifted program
+    if (op.code == OpConst && !_ops.isEmpty() && _ops.last().code == OpConst)
+    {
+        _ops.last().mt *= op.mt;
+        _ops.last().ms *= op.ms;
+    }
+    else _ops << op;
+}
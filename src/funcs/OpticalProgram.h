@@ -0,0 +1,98 @@
+#ifndef OPTICAL_PROGRAM_H
+#define OPTICAL_PROGRAM_H
+
+#include "../core/Math.h"
+#include "../core/Parameters.h"
+
+#include <QHash>
+#include <QVector>
+
+class Element;
+class RoundTripCalculator;
+
+/**
+    Compiled representation of a round-trip for hot loops of parameter sweeps.
+
+    The compiler takes a round-trip prepared by @ref RoundTripCalculator and turns it into
+    a flat array of operations. Products of runs of elements that are not varied are folded
+    into constant operations, and each occurrence of a varied element becomes an operation
+    of its element kind reading parameter values from numbered slots in SI units.
+    Parameters linked to other parameters share slots with their sources.
+
+    When a parameter is changed, only its slot is rewritten, and `run()` recalculates
+    round-trip matrices without touching elements, their parameters, and units.
+
+    Only real round-trips and a limited set of element kinds can be compiled,
+    `compile()` returns false otherwise and callers should use the calculator as usual.
+*/
+class OpticalProgram
+{
+public:
+    /// Compiles the round-trip of the calculator for varying parameters of the given elements.
+    /// Matrices of all other elements are taken as they are at the moment of compilation.
+    bool compile(const RoundTripCalculator* calc, const QList<Element*>& variedElems);
+
+    /// Description of why the last compilation failed.
+    const QString& error() const { return _error; }
+
+    /// Returns index of the slot holding the parameter's value or -1
+    /// when the parameter doesn't affect the compiled round-trip.
+    int slot(Z::Parameter* param) const { return _slotIndex.value(param, -1); }
+
+    void setSlot(int slot, double valueSi) { _slots[slot] = valueSi; }
+    double slotValue(int slot) const { return _slots.at(slot); }
+
+    /// Calculates round-trip matrices for current slot values.
+    void run();
+
+    /// Splits the program into two parts so that the round-trip is their product
+    /// taken in some cyclic shift: `M' = X * Y` where the part X depends only on the slot X
+    /// and the part Y depends only on the slot Y. A cyclic shift of round-trip doesn't change
+    /// its trace, so the stability can be calculated from the products of parts,
+    /// and each part can be recalculated only when its own slot changes.
+    /// Returns false if some operation depends on both slots (e.g. an interface between
+    /// two varied ranges) or if operations depending on them are interleaved in the round-trip.
+    bool split(int slotX, int slotY, OpticalProgram& partX, OpticalProgram& partY) const;
+
+    int opsCount() const { return _ops.size(); }
+
+    const Z::Matrix& Mt() const { return _mt; }
+    const Z::Matrix& Ms() const { return _ms; }
+    const Z::RealMatrix& realMt() const { return _realMt; }
+    const Z::RealMatrix& realMs() const { return _realMs; }
+
+private:
+    enum OpCode
+    {
+        OpConst,
+        OpRange,
+        OpPlate,
+        OpCurveMirror,
+        OpThinLens,
+        OpCylinderLensT,
+        OpCylinderLensS,
+        OpNormalInterface,
+        OpBrewsterInterface,
+    };
+
+    struct Op
+    {
+        OpCode code;
+        int arg1 = -1;
+        int arg2 = -1;
+        Z::RealMatrix mt, ms;
+    };
+
+    QVector<Op> _ops;
+    QVector<double> _slots;
+    QHash<Z::Parameter*, int> _slotIndex;
+    QString _error;
+    Z::Matrix _mt, _ms;
+    Z::RealMatrix _realMt, _realMs;
+
+    void append(const Op& op);
+    bool compileElement(Element* elem, bool inverse, Z::ParamLinks* links);
+    int slotOf(Z::Parameter* param, Z::ParamLinks* links);
+};
+
+#endif // OPTICAL_PROGRAM_H
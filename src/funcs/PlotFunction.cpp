@@ -3,6 +3,8 @@
 #include "../core/Schema.h"
 #include "../core/Protocol.h"
 
+#include <QMap>
+
 //------------------------------------------------------------------------------
 //                                FunctionRange
 //------------------------------------------------------------------------------
@@ -160,6 +162,57 @@ void PlotFunction::finishResults()
         setError(qApp->translate("Calc error", "No one valid point was calculated"));
 }
 
+bool PlotFunction::takeCachedResults()
+{
+    ResultCache::Key key;
+    key << alias() << int(_schema->tripType()) << _schema->wavelength().value()
+        << _adaptive << _adaptivePointsLimit;
+    key << _schema->indexOf(_arg.element) << (_arg.parameter ? _arg.parameter->alias() : QString())
+        << _arg.range.start << _arg.range.stop << _arg.range.step
+        << _arg.range.points << _arg.range.useStep;
+    if (_calc)
+        for (auto elem : _calc->matrixOwners())
+            key << elem;
+    if (!_schema->isResonator())
+        key << _schema->activePump();
+    addCacheKeyOptions(key);
+    _cacheKey = key.result();
+
+    if (!ResultCache::instance().take(_cacheKey, _results))
+        return false;
+    finishResults();
+    return true;
+}
+
+void PlotFunction::cacheResults()
+{
+    if (!ok() || _cacheKey.isEmpty()) return;
+
+    int cost = 0;
+    for (auto resultSet : { &_results.T, &_results.S })
+        cost += resultSet->allPointsCount() * 2 * int(sizeof(double)) + resultSet->results.size() * 64;
+    ResultCache::instance().put(_cacheKey, _results, cost);
+    _cacheKey.clear();
+}
+
+FunctionInputs PlotFunction::inputs() const
+{
+    FunctionInputs inputs;
+    if (!_calc || !ok()) return inputs;
+
+    inputs.allElements = false;
+    inputs.elements = _calc->matrixOwners();
+    if (_arg.element && !inputs.elements.contains(_arg.element))
+        inputs.elements << _arg.element;
+    // Enabling of element changes the round-trip
+    for (auto elem : _schema->elements())
+        if (elem->disabled())
+            inputs.elements << elem;
+    inputs.pump = !_schema->isResonator();
+    inputs.globalParams = false;
+    return inputs;
+}
+
 bool PlotFunction::prepareCalculator(Element* ref, bool splitRange)
 {
     if (_calc) delete _calc;
@@ -182,6 +235,100 @@ void PlotFunction::addResultPoint(double x, double y_t, double y_s)
     _results.S.addPoint(x, y_s);
 }
 
+QVector<PlotFunction::Sample> PlotFunction::samplePoints(const Z::PlottingRange& range, const CalcPointFunc& calcPoint) const
+{
+    QVector<Sample> samples;
+    samples.reserve(range.points());
+    for (auto x : range.values())
+        samples.append({x, calcPoint(x)});
+
+    if (!_adaptive || samples.size() < 3) return samples;
+
+    // Intervals are not halved more times than this, it's enough to place
+    // a point close to a pole and keeps the loop finite when the limit is large
+    const int maxDepth = 8;
+    // Deviation from a straight line, relative to the function's span on the initial points
+    const double tolerance = 0.002;
+
+    int pointsLimit = _adaptivePointsLimit > 0 ? _adaptivePointsLimit : 4 * range.points();
+    double minInterval = range.step() / double(1 << maxDepth);
+
+    auto isValid = [](double y) { return !std::isnan(y) && !std::isinf(y); };
+
+    Z::PointTS span(0, 0);
+    for (auto plane : { &Z::PointTS::T, &Z::PointTS::S })
+    {
+        double minY = Double::nan(), maxY = Double::nan();
+        for (const Sample& s : qAsConst(samples))
+        {
+            double y = s.y.*plane;
+            if (!isValid(y)) continue;
+            if (std::isnan(minY) || y < minY) minY = y;
+            if (std::isnan(maxY) || y > maxY) maxY = y;
+        }
+        span.*plane = maxY > minY ? maxY - minY : 1;
+    }
+
+    while (samples.size() < pointsLimit)
+    {
+        // Score of each interval between neighbour points, the greater the more it needs to be halved
+        int count = samples.size();
+        QVector<double> scores(count-1, 0);
+        for (auto plane : { &Z::PointTS::T, &Z::PointTS::S })
+        {
+            for (int i = 0; i < count-1; i++)
+            {
+                double y1 = samples.at(i).y.*plane;
+                double y2 = samples.at(i+1).y.*plane;
+                if (isValid(y1) != isValid(y2) || (isValid(y1) && y1 * y2 < 0))
+                    scores[i] = qInf();
+            }
+            for (int i = 1; i < count-1; i++)
+            {
+                const Sample& s0 = samples.at(i-1);
+                const Sample& s1 = samples.at(i);
+                const Sample& s2 = samples.at(i+1);
+                double y0 = s0.y.*plane, y1 = s1.y.*plane, y2 = s2.y.*plane;
+                if (!isValid(y0) || !isValid(y1) || !isValid(y2)) continue;
+                double t = (s1.x - s0.x) / (s2.x - s0.x);
+                double deviation = qAbs(y1 - (y0 + (y2 - y0) * t)) / span.*plane;
+                if (deviation > tolerance)
+                {
+                    scores[i-1] = qMax(scores.at(i-1), deviation);
+                    scores[i] = qMax(scores.at(i), deviation);
+                }
+            }
+        }
+
+        // Intervals having the greatest scores are halved first
+        QMultiMap<double, int> candidates;
+        for (int i = 0; i < count-1; i++)
+            if (scores.at(i) > 0 && samples.at(i+1).x - samples.at(i).x > 2 * minInterval)
+                candidates.insert(-scores.at(i), i);
+        if (candidates.isEmpty()) break;
+
+        QVector<bool> halve(count-1, false);
+        int added = 0;
+        for (auto it = candidates.constBegin(); it != candidates.constEnd() && count + added < pointsLimit; it++, added++)
+            halve[it.value()] = true;
+
+        QVector<Sample> refined;
+        refined.reserve(count + added);
+        for (int i = 0; i < count; i++)
+        {
+            refined.append(samples.at(i));
+            if (i < count-1 && halve.at(i))
+            {
+                double x = (samples.at(i).x + samples.at(i+1).x) / 2.0;
+                refined.append({x, calcPoint(x)});
+            }
+        }
+        samples = refined;
+    }
+    Z_INFO("Adaptive points count:" << samples.size() << "of" << pointsLimit)
+    return samples;
+}
+
 const PlotFuncResultSet* PlotFunction::results(Z::WorkPlane plane) const
 {
     switch (plane)
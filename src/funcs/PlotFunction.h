@@ -3,7 +3,11 @@
 
 #include <QVector>
 
+#include <atomic>
+#include <functional>
+
 #include "FunctionBase.h"
+#include "ResultCache.h"
 #include "../core/Variable.h"
 #include "../core/CommonTypes.h"
 
@@ -62,6 +66,27 @@ public:
 
     virtual void calculate() {}
 
+    /// The part of calculation that can be run in a background thread. See @ref prepareJob().
+    typedef std::function<void(const std::atomic<bool>& cancelled)> Job;
+
+    /// Defines if function can be calculated in a background thread. See @ref prepareJob().
+    /// Currently only the 2D stability map does, other functions are fast enough
+    /// to be calculated in the schema's thread by @ref calculate().
+    virtual bool canCalculateInBackground() const { return false; }
+
+    /// Does all the work requiring the schema and must be called in the schema's thread.
+    /// Returns the rest of calculation using only data isolated from the schema and the function,
+    /// so it can be run in any thread, while the schema or function options can be changed in the meantime.
+    /// The job calculates into its own buffers, they are taken by @ref finishJob().
+    /// The job should check the `cancelled` flag regularly and stop as soon as possible
+    /// when it's set, then its results are incomplete and are just dropped.
+    /// An empty job is returned when the calculation can't be started, see @ref errorText().
+    virtual Job prepareJob() { return Job(); }
+
+    /// Takes results of the job returned by the last @ref prepareJob() into the function.
+    /// Must be called in the schema's thread after the job has finished without being cancelled.
+    virtual void finishJob() {}
+
     /// Defines if function can calculate notable values. See @ref calculateNotables().
     virtual bool hasNotables() const { return false; }
 
@@ -106,6 +131,19 @@ public:
 
     RoundTripCalculator* roundTripCalculator() const { return _calc; }
 
+    /// Function depends on elements of the round-trip used in the last successful calculation.
+    /// Pump is only used in single-pass schemas.
+    FunctionInputs inputs() const override;
+
+    /// Defines if function places its points adaptively. See @ref samplePoints().
+    bool adaptive() const { return _adaptive; }
+    void setAdaptive(bool on) { _adaptive = on; }
+
+    /// Maximal number of points calculated in adaptive mode.
+    /// Zero means four times more than the number of points in the plotting range.
+    int adaptivePointsLimit() const { return _adaptivePointsLimit; }
+    void setAdaptivePointsLimit(int limit) { _adaptivePointsLimit = limit; }
+
 protected:
     Z::Variable _arg;
     RoundTripCalculator* _calc = nullptr;
@@ -113,8 +151,35 @@ protected:
     FunctionRange _range;
     Z::Value _backupValue;
 
+    struct Sample
+    {
+        double x;
+        Z::PointTS y;
+    };
+
+    typedef std::function<Z::PointTS(double x)> CalcPointFunc;
+
+    /// Calculates function values at points of the range and returns them in ascending order of x.
+    /// In adaptive mode the equally spaced points of the range are only the initial approximation.
+    /// Then intervals where values change sign or become invalid (e.g. at poles or stability
+    /// boundaries), or where the function curves noticeably, are halved until there are no such
+    /// intervals or the points limit is reached. Results can be passed to @ref addResultPoint()
+    /// in the returned order, so plot segments are split at poles as usual.
+    QVector<Sample> samplePoints(const Z::PlottingRange& range, const CalcPointFunc& calcPoint) const;
+
     void setError(const QString& error);
 
+    /// Takes results calculated earlier for the same inputs from @ref ResultCache.
+    /// It should be called when the round-trip is prepared and the calculation is about to begin.
+    /// When there are no such results, the function calculates them as usual
+    /// and then passes them to the cache via @ref cacheResults().
+    bool takeCachedResults();
+    void cacheResults();
+
+    /// Adds to the cache key everything affecting results of the function besides of
+    /// the round-trip, argument, wavelength, and active pump, e.g. function mode.
+    virtual void addCacheKeyOptions(ResultCache::Key&) const {}
+
     bool prepareResults(Z::PlottingRange range);
     void finishResults();
     void addResultPoint(double x, double y_t, double y_s);
@@ -126,6 +191,9 @@ protected:
 
 private:
     QString _errorText;
+    bool _adaptive = false;
+    int _adaptivePointsLimit = 0;
+    QByteArray _cacheKey;
 };
 
 #endif // PLOT_FUNCTION_H
@@ -161,6 +161,19 @@ class PumpCalculatorImpl final
         return beam;
     }
 
+    void calcVector(const MatrixBatch& m, double* w, double* r, double* v)
+    {
+        const double *A = m.A(), *B = m.B(), *C = m.C(), *D = m.D();
+        for (int i = 0; i < m.size(); i++)
+        {
+            const double Y = inputRay.Y * A[i] + inputRay.V * B[i];
+            const double V = inputRay.Y * C[i] + inputRay.V * D[i];
+            w[i] = Y;
+            v[i] = V;
+            r[i] = Y / sin(V);
+        }
+    }
+
     BeamResult calcGauss(const Matrix& matrix, double ior)
     {
         const double lambda = wavelen / ior;
@@ -197,6 +210,38 @@ class PumpCalculatorImpl final
         beam.frontRadius = R;
         return beam;
     }
+
+    // The same as calcGauss() but for real matrices, so complex arithmetic
+    // is expanded into real one and the loop has no branches
+    void calcGauss(const MatrixBatch& m, double ior, double* w, double* r, double* v)
+    {
+        const double lambda = wavelen / ior;
+        const double qr = inputQ.real();
+        const double qi = inputQ.imag();
+        const double *A = m.A(), *B = m.B(), *C = m.C(), *D = m.D();
+        for (int i = 0; i < m.size(); i++)
+        {
+            // 1/q = (C*q_in + D) / (A*q_in + B)
+            const double nr = A[i] * qr + B[i];
+            const double ni = A[i] * qi;
+            const double dr = C[i] * qr + D[i];
+            const double di = C[i] * qi;
+            const double n2 = nr * nr + ni * ni;
+            const double q_inv_re = (dr * nr + di * ni) / n2;
+            const double q_inv_im = (di * nr - dr * ni) / n2;
+
+            const double R = 1.0 / q_inv_re;
+            const double w_equiv_2 = lambda / M_PI / std::fabs(q_inv_im);
+            const double tmp = SQR(w_equiv_2 * M_PI);
+            const double z = tmp * R / (SQR(lambda * R) + tmp);
+            const double z0_hyper = sqrt(z * (R - z));
+            const double w0_hyper = sqrt(z0_hyper * MI * lambda / M_PI);
+
+            w[i] = sqrt(w_equiv_2 * MI);
+            r[i] = R;
+            v[i] = w0_hyper / z0_hyper;
+        }
+    }
 };
 
 //--------------------------------------------------------------------------------
@@ -247,3 +292,34 @@ BeamResult PumpCalculator::calc(const Z::Matrix& matrix, double ior)
     qCritical() << "Unsupported pump calculation mode" << int(_impl->mode);
     return { Double::nan(), Double::nan(), Double::nan() };
 }
+
+void PumpCalculator::calc(const Z::MatrixBatch& matrices, double ior, double* beamRadius, double* frontRadius, double* halfAngle)
+{
+    // Complex matrices and protocol are only supported by per-point calculation
+    if (!matrices.isReal() || _impl->protocol)
+    {
+        for (int i = 0; i < matrices.size(); i++)
+        {
+            BeamResult beam = calc(matrices.at(i), ior);
+            beamRadius[i] = beam.beamRadius;
+            frontRadius[i] = beam.frontRadius;
+            halfAngle[i] = beam.halfAngle;
+        }
+        return;
+    }
+
+    switch (_impl->mode)
+    {
+    case PumpCalculatorImpl::GAUSS:
+        _impl->calcGauss(matrices, ior, beamRadius, frontRadius, halfAngle);
+        return;
+
+    case PumpCalculatorImpl::RAY_VECTOR:
+        _impl->calcVector(matrices, beamRadius, frontRadius, halfAngle);
+        return;
+    }
+
+    qCritical() << "Unsupported pump calculation mode" << int(_impl->mode);
+    for (int i = 0; i < matrices.size(); i++)
+        beamRadius[i] = frontRadius[i] = halfAngle[i] = Double::nan();
+}
@@ -7,6 +7,7 @@ class PumpParams;
 
 namespace Z {
 class Matrix;
+class MatrixBatch;
 }
 
 struct BeamResult
@@ -27,6 +28,10 @@ public:
     bool init(PumpParams* pump, double lambdaSI, const char* ident = nullptr, bool writeProtocol = false);
     BeamResult calc(const Z::Matrix& matrix, double ior);
 
+    /// Calculates beam for each matrix of the batch and writes its parameters
+    /// to arrays having at least the size of the batch.
+    void calc(const Z::MatrixBatch& matrices, double ior, double* beamRadius, double* frontRadius, double* halfAngle);
+
 private:
     PumpCalculator() = default;
     PumpCalculator(const PumpCalculator& other) = delete;
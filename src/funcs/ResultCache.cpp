@@ -0,0 +1,134 @@
+#include "ResultCache.h"
+
+#include "../AppSettings.h"
+#include "../core/Element.h"
+#include "../core/Protocol.h"
+#include "../core/Pump.h"
+
+ResultCache& ResultCache::instance()
+{
+    static ResultCache cache;
+    return cache;
+}
+
+ResultCache::ResultCache()
+{
+}
+
+void ResultCache::setLimit(int bytes)
+{
+    _cache.setMaxCost(qMax(0, bytes));
+    _limitSet = true;
+}
+
+void ResultCache::applySettings()
+{
+    if (_limitSet) return;
+    int megabytes = qBound(0, AppSettings::instance().resultCacheSizeMb, 1024);
+    _cache.setMaxCost(megabytes * 1024 * 1024);
+}
+
+void ResultCache::clear()
+{
+    _cache.clear();
+    _hits = 0;
+    _misses = 0;
+}
+
+ResultCache::EntryBase* ResultCache::lookup(const QByteArray& key, const char* type)
+{
+    applySettings();
+    if (_cache.maxCost() == 0) return nullptr;
+
+    auto entry = _cache.object(key + type);
+    if (entry) _hits++; else _misses++;
+    report(entry ? "hit" : "miss");
+    return entry;
+}
+
+void ResultCache::insert(const QByteArray& key, const char* type, EntryBase* entry, int cost)
+{
+    applySettings();
+    // The cache deletes the entry itself when it doesn't fit
+    _cache.insert(key + type, entry, qMax(1, cost));
+}
+
+void ResultCache::report(const char* event)
+{
+    Z_REPORT(QString("Result cache %1: hits=%2, misses=%3, entries=%4, size=%5 of %6 KB")
+             .arg(event).arg(_hits).arg(_misses).arg(_cache.count())
+             .arg(_cache.totalCost() / 1024).arg(_cache.maxCost() / 1024))
+}
+
+//------------------------------------------------------------------------------
+//                              ResultCache::Key
+//------------------------------------------------------------------------------
+
+ResultCache::Key::Key() : _hash(QCryptographicHash::Sha1)
+{
+}
+
+ResultCache::Key& ResultCache::Key::operator << (bool v)
+{
+    char c = v ? 1 : 0;
+    _hash.addData(&c, sizeof(c));
+    return *this;
+}
+
+ResultCache::Key& ResultCache::Key::operator << (int v)
+{
+    _hash.addData(reinterpret_cast<const char*>(&v), sizeof(v));
+    return *this;
+}
+
+ResultCache::Key& ResultCache::Key::operator << (double v)
+{
+    _hash.addData(reinterpret_cast<const char*>(&v), sizeof(v));
+    return *this;
+}
+
+ResultCache::Key& ResultCache::Key::operator << (const QString& v)
+{
+    // Length separates consecutive strings, so that "ab"+"c" differs from "a"+"bc"
+    *this << v.size();
+    _hash.addData(reinterpret_cast<const char*>(v.constData()), v.size() * int(sizeof(QChar)));
+    return *this;
+}
+
+ResultCache::Key& ResultCache::Key::operator << (const Z::Value& v)
+{
+    return *this << v.toSi();
+}
+
+ResultCache::Key& ResultCache::Key::operator << (const Element* elem)
+{
+    if (!elem) return *this << QString();
+
+    *this << elem->type() << elem->disabled() << elem->params().size();
+    for (auto param : elem->params())
+        *this << param->alias() << param->value();
+
+    if (!dynamic_cast<const ElementDynamic*>(elem))
+        for (auto m : { elem->pMt(), elem->pMs(), elem->pMt_inv(), elem->pMs_inv() })
+            for (const auto& v : { m->A, m->B, m->C, m->D })
+                *this << v.real() << v.imag();
+    return *this;
+}
+
+ResultCache::Key& ResultCache::Key::operator << (PumpParams* pump)
+{
+    if (!pump) return *this << QString();
+
+    *this << pump->modeName() << pump->params()->size();
+    for (auto param : *pump->params())
+        *this << param->alias() << param->value().rawValueT() << param->value().rawValueS()
+              << param->value().unit()->toSi(1.0);
+    return *this;
+}
+
+ResultCache::Key& ResultCache::Key::addIdentity(const void* p)
+{
+    auto v = reinterpret_cast<quintptr>(p);
+    _hash.addData(reinterpret_cast<const char*>(&v), sizeof(v));
+    return *this;
+}
@@ -0,0 +1,114 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <QCache>
+#include <QCryptographicHash>
+
+#include <typeinfo>
+
+class Element;
+class PumpParams;
+
+namespace Z {
+class Value;
+}
+
+/**
+    Cache of calculation results addressed by content of their inputs.
+
+    A function builds a key from everything its results depend on (see @ref Key)
+    and gets results calculated earlier for the same key instead of calculating them again.
+    Results are kept within the memory limit set in application settings,
+    the least recently used ones are evicted first when the limit is reached.
+    Hits and misses are reported into the protocol.
+*/
+class ResultCache
+{
+public:
+    static ResultCache& instance();
+
+    /// Key builder hashing all the values fed to it.
+    class Key
+    {
+    public:
+        Key();
+
+        Key& operator << (bool v);
+        Key& operator << (int v);
+        Key& operator << (double v);
+        Key& operator << (const QString& v);
+        Key& operator << (const Z::Value& v);
+
+        /// Adds the element's type, parameters, and matrices.
+        /// Matrices of dynamic elements are not added, they are calculated
+        /// from the beam during the calculation and don't belong to inputs.
+        Key& operator << (const Element* elem);
+
+        /// Adds the pump's mode and parameters.
+        Key& operator << (PumpParams* pump);
+
+        /// Adds the pointer itself, it's for results referencing objects,
+        /// they only can be reused when they reference exactly the same objects.
+        Key& addIdentity(const void* p);
+
+        QByteArray result() const { return _hash.result(); }
+
+    private:
+        QCryptographicHash _hash;
+    };
+
+    /// Copies results stored for the key into the value and returns true, or returns false if there are none.
+    template <typename T> bool take(const QByteArray& key, T& value)
+    {
+        auto entry = lookup(key, typeid(T).name());
+        if (entry) value = static_cast<Entry<T>*>(entry)->value;
+        return entry != nullptr;
+    }
+
+    /// Stores results for the key. The cost is an estimated memory size of the value in bytes.
+    template <typename T> void put(const QByteArray& key, const T& value, int cost)
+    {
+        auto entry = new Entry<T>;
+        entry->value = value;
+        insert(key, typeid(T).name(), entry, cost);
+    }
+
+    void clear();
+
+    int hits() const { return _hits; }
+    int misses() const { return _misses; }
+    int count() const { return _cache.count(); }
+
+    /// Estimated size of stored results in bytes.
+    int size() const { return _cache.totalCost(); }
+
+    /// Memory limit in bytes, zero disables the cache.
+    /// By default, the limit is taken from application settings.
+    int limit() const { return _cache.maxCost(); }
+    void setLimit(int bytes);
+
+private:
+    ResultCache();
+
+    struct EntryBase
+    {
+        virtual ~EntryBase() {}
+    };
+
+    template <typename T> struct Entry : public EntryBase
+    {
+        T value;
+    };
+
+    QCache<QByteArray, EntryBase> _cache;
+    int _hits = 0;
+    int _misses = 0;
+    bool _limitSet = false;
+
+    EntryBase* lookup(const QByteArray& key, const char* type);
+    void insert(const QByteArray& key, const char* type, EntryBase* entry, int cost);
+    void applySettings();
+    void report(const char* event);
+};
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,96 @@
+#include "RootFinder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <QDebug>
+
+#define MAX_SOLVE_ITERATIONS 1000
+
+namespace RootFinder {
+
+double brent(const Function& f, double a, double b, double fa, double fb)
+{
+    if (fa == 0) return a;
+    if (fb == 0) return b;
+    if (std::isnan(fa) || std::isnan(fb) || (fa > 0) == (fb > 0))
+        return std::nan("");
+
+    // b is the current approximation, a is the previous one,
+    // and c is the opposite end of the bracket, so the root is always between b and c
+    double c = b, fc = fb;
+    double d = b - a, e = d;
+    for (int i = 0; i < MAX_SOLVE_ITERATIONS; i++)
+    {
+        if ((fb > 0) == (fc > 0))
+        {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (std::abs(fc) < std::abs(fb))
+        {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+
+        const double tol = 2.0 * DBL_EPSILON * std::abs(b) + DBL_MIN;
+        const double m = 0.5 * (c - b);
+        if (std::abs(m) <= tol || fb == 0)
+            return b;
+
+        if (std::abs(e) >= tol && std::abs(fa) > std::abs(fb))
+        {
+            // Try interpolation: secant when there are only two points, inverse quadratic otherwise
+            double p, q;
+            const double s = fb / fa;
+            if (a == c)
+            {
+                p = 2.0 * m * s;
+                q = 1.0 - s;
+            }
+            else
+            {
+                const double r = fb / fc;
+                q = fa / fc;
+                p = s * (2.0 * m * q * (q - r) - (b - a) * (r - 1.0));
+                q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0) q = -q; else p = -p;
+            if (2.0 * p < std::min(3.0 * m * q - std::abs(tol * q), std::abs(e * q)))
+            {
+                e = d;
+                d = p / q;
+            }
+            else
+            {
+                // Interpolation doesn't converge fast enough, fall back to bisection
+                d = m;
+                e = m;
+            }
+        }
+        else
+        {
+            d = m;
+            e = m;
+        }
+
+        a = b;
+        fa = fb;
+        b += std::abs(d) > tol ? d : (m > 0 ? tol : -tol);
+        fb = f(b);
+        if (std::isnan(fb))
+            return std::nan("");
+    }
+    qWarning() << QString("Root finding is not finished after %1 iterations. Stopped at x=%2 f=%3")
+                  .arg(MAX_SOLVE_ITERATIONS).arg(b, 0, 'g', 16).arg(fb, 0, 'g', 16);
+    return b;
+}
+
+double brent(const Function& f, double a, double b)
+{
+    return brent(f, a, b, f(a), f(b));
+}
+
+} // namespace RootFinder
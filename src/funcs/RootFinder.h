@@ -0,0 +1,21 @@
+#ifndef ROOT_FINDER_H
+#define ROOT_FINDER_H
+
+#include <functional>
+
+namespace RootFinder {
+
+typedef std::function<double(double)> Function;
+
+/// Finds a root of the function inside of the bracket [a, b] by Brent's method.
+/// Values of the function at the ends of the bracket must have different signs,
+/// they are usually known from a preceding scan, so they are passed to avoid recalculation.
+/// The root is refined to machine precision, NaN is returned when the bracket is invalid.
+double brent(const Function& f, double a, double b, double fa, double fb);
+
+/// The same as above but calculates the function at the ends of the bracket.
+double brent(const Function& f, double a, double b);
+
+} // namespace RootFinder
+
+#endif // ROOT_FINDER_H
@@ -35,6 +35,11 @@ void RoundTripCalculator::reset()
     _matrsS.clear();
     _mt.unity();
     _ms.unity();
+    _isReal = false;
+    resetVariedElements();
+    _treeT.clear();
+    _treeS.clear();
+    _treeDisabledElems.clear();
 }
 
 void RoundTripCalculator::calcRoundTripSW()
@@ -135,6 +140,7 @@ void RoundTripCalculator::collectMatrices()
         _matrsT << range->pMt2();
         _matrsS << range->pMs2();
     }
+    checkIsReal();
 }
 
 void RoundTripCalculator::collectMatricesSP()
@@ -171,22 +177,160 @@ void RoundTripCalculator::collectMatricesSP()
         }
         i++;
     }
+    checkIsReal();
+}
+
+void RoundTripCalculator::checkIsReal()
+{
+    _isReal = false;
+    for (auto elem : _matrixOwners)
+        if (elem->hasOption(Element_ComplexMatrix))
+            return;
+    for (int i = 0; i < _matrsT.size(); i++)
+        if (!_matrsT.at(i)->isReal() || !_matrsS.at(i)->isReal())
+            return;
+    _isReal = true;
+}
+
+QList<Element*> RoundTripCalculator::withLinkedElements(const QList<Element*>& elems) const
+{
+    QList<Element*> linked(elems);
+    bool added = true;
+    while (added)
+    {
+        added = false;
+        for (auto link : *_schema->paramLinks())
+        {
+            auto source = Z::Utils::findElemByParam(_schema, link->source());
+            if (!source || !linked.contains(source)) continue;
+            auto target = Z::Utils::findElemByParam(_schema, link->target());
+            if (!target || linked.contains(target)) continue;
+            linked << target;
+            added = true;
+        }
+    }
+    return linked;
+}
+
+void RoundTripCalculator::setVariedElements(const QList<Element*>& elems)
+{
+    resetVariedElements();
+
+    // Elements can be linked to varied ones, e.g. interfaces take IORs from neighbour ranges
+    auto varied = withLinkedElements(elems);
+
+    // Reserve enough space to guarantee pointers to cached items stay valid
+    _cachedT.reserve(_matrsT.size());
+    _cachedS.reserve(_matrsS.size());
+
+    int runLen = 0;
+    for (int i = 0; i < _matrsT.size(); i++)
+    {
+        if (!varied.contains(_matrixOwners.at(i)))
+        {
+            if (runLen == 0)
+            {
+                _cachedT << Z::Matrix();
+                _cachedS << Z::Matrix();
+                _sweepMatrsT << &_cachedT.last();
+                _sweepMatrsS << &_cachedS.last();
+            }
+            _cachedT.last() *= _matrsT.at(i);
+            _cachedS.last() *= _matrsS.at(i);
+            runLen++;
+        }
+        else
+        {
+            _sweepMatrsT << _matrsT.at(i);
+            _sweepMatrsS << _matrsS.at(i);
+            runLen = 0;
+        }
+    }
+    _hasVariedElems = true;
+}
+
+void RoundTripCalculator::resetVariedElements()
+{
+    _sweepMatrsT.clear();
+    _sweepMatrsS.clear();
+    _cachedT.clear();
+    _cachedS.clear();
+    _hasVariedElems = false;
+}
+
+void RoundTripCalculator::buildProductTree()
+{
+    _treeT.build(_matrsT);
+    _treeS.build(_matrsS);
+    _treeDisabledElems.clear();
+    for (auto elem : _schema->elements())
+        if (elem->disabled())
+            _treeDisabledElems << elem;
+    _mt = _treeT.product();
+    _ms = _treeS.product();
+}
+
+bool RoundTripCalculator::updateElements(const QList<Element*>& elems)
+{
+    if (!hasProductTree()) return false;
+
+    for (auto elem : elems)
+        if (elem->disabled() != _treeDisabledElems.contains(elem))
+            return false;
+
+    // Elements linked to the changed ones get changed too, e.g. interfaces take IORs from neighbour ranges
+    auto changed = withLinkedElements(elems);
+    for (int i = 0; i < _matrixOwners.size(); i++)
+        if (changed.contains(_matrixOwners.at(i)))
+        {
+            _treeT.update(i);
+            _treeS.update(i);
+        }
+    _mt = _treeT.product();
+    _ms = _treeS.product();
+    return true;
 }
 
 void RoundTripCalculator::multMatrix()
 {
+    const Z::MatrixArray& matrsT = _hasVariedElems ? _sweepMatrsT : _matrsT;
+    const Z::MatrixArray& matrsS = _hasVariedElems ? _sweepMatrsS : _matrsS;
+
+    if (_isReal)
+    {
+        Z::RealMatrix mt, ms;
+        for (int i = 0; i < matrsT.size(); i++)
+        {
+            mt *= matrsT[i];
+            ms *= matrsS[i];
+        }
+        _mt.assign(mt.A, mt.B, mt.C, mt.D);
+        _ms.assign(ms.A, ms.B, ms.C, ms.D);
+        return;
+    }
+
     _mt.unity();
     _ms.unity();
-    for (int i = 0; i < _matrsT.size(); i++)
+    for (int i = 0; i < matrsT.size(); i++)
     {
-        _mt *= _matrsT[i];
-        _ms *= _matrsS[i];
+        _mt *= matrsT[i];
+        _ms *= matrsS[i];
     }
 }
 
 Z::PointTS RoundTripCalculator::stability() const
 {
-    return { calcStability(_mt), calcStability(_ms) };
+    return stability(_mt, _ms, _stabilityCalcMode);
+}
+
+Z::PointTS RoundTripCalculator::stability(const Z::Matrix& mt, const Z::Matrix& ms) const
+{
+    return stability(mt, ms, _stabilityCalcMode);
+}
+
+Z::PointTS RoundTripCalculator::stability(const Z::Matrix& mt, const Z::Matrix& ms, Z::Enums::StabilityCalcMode mode)
+{
+    return { calcStability(mt, mode), calcStability(ms, mode) };
 }
 
 Z::PairTS<bool> RoundTripCalculator::isStable() const
@@ -201,11 +345,11 @@ bool RoundTripCalculator::isStable(const Z::Matrix& m) const
     return (half_of_A_plus_D > -1) && (half_of_A_plus_D < 1);
 }
 
-double RoundTripCalculator::calcStability(const Z::Matrix& m) const
+double RoundTripCalculator::calcStability(const Z::Matrix& m, Z::Enums::StabilityCalcMode mode)
 {
     // TODO:COMPLEX: what about imaginary part?
     auto half_of_A_plus_D = (m.A + m.D) * 0.5;
-    switch (_stabilityCalcMode)
+    switch (mode)
     {
     case Z::Enums::StabilityCalcMode::Normal:
         return half_of_A_plus_D.real();
@@ -20,7 +20,49 @@ public:
     void reset();
     bool isEmpty() { return _roundTrip.isEmpty(); }
 
+    /// Round-trip is real when all its matrices have zero imaginary parts
+    /// and there are no elements able to produce complex matrices (see @ref Element_ComplexMatrix).
+    /// Then `multMatrix()` uses fast real-valued multiplication.
+    /// Valid only after calcRoundTrip() call.
+    bool isReal() const { return _isReal; }
+
+    /// Prepares the calculator for sweeping parameters of the given elements.
+    /// Products of runs of matrices not owned by varied elements are calculated once and cached,
+    /// so `multMatrix()` then costs a few products regardless of round-trip length.
+    /// Elements whose parameters are linked to parameters of varied elements are considered as varied too.
+    /// Should be called after calcRoundTrip() and after all other matrices are prepared
+    /// (e.g. dynamic elements in SP schemas), because they are not recalculated until the next call.
+    void setVariedElements(const QList<Element*>& elems);
+
+    /// Drops cached products, `multMatrix()` multiplies the whole round-trip again.
+    void resetVariedElements();
+
+    bool hasVariedElements() const { return _hasVariedElems; }
+
+    /// Returns the given elements together with all elements whose parameters are linked to them.
+    QList<Element*> withLinkedElements(const QList<Element*>& elems) const;
+
+    /// Builds product trees over the round-trip matrices and assigns round-trip matrices from them.
+    /// After that, when matrices of some elements change, call updateElements()
+    /// to refresh the round-trip matrices in O(log N) products instead of calling multMatrix().
+    /// Should be called after calcRoundTrip(), trees are dropped by the next calcRoundTrip().
+    void buildProductTree();
+
+    /// Refreshes round-trip matrices after matrices of the given elements have been changed.
+    /// Elements linked to the given ones are refreshed too, and each occurrence of an element
+    /// in the round-trip is updated (e.g. both forward and back passes in SW schemas).
+    /// Returns false when some of the elements has been enabled or disabled since the trees were built,
+    /// then round-trip itself is changed and calcRoundTrip() should be called instead.
+    bool updateElements(const QList<Element*>& elems);
+
+    bool hasProductTree() const { return !_treeT.isEmpty(); }
+
     Z::PointTS stability() const;
+    /// Calculates stability of the given round-trip matrices in the current stability calculation mode.
+    Z::PointTS stability(const Z::Matrix& mt, const Z::Matrix& ms) const;
+    /// Calculates stability of the given round-trip matrices in the given stability calculation mode.
+    /// It doesn't use any calculator, so it can be called from any thread.
+    static Z::PointTS stability(const Z::Matrix& mt, const Z::Matrix& ms, Z::Enums::StabilityCalcMode mode);
     Z::PairTS<bool> isStable() const;
     Z::Enums::StabilityCalcMode stabilityCalcMode() const { return _stabilityCalcMode; }
     void setStabilityCalcMode(Z::Enums::StabilityCalcMode mode) { _stabilityCalcMode = mode; }
@@ -81,7 +123,18 @@ protected:
 
     Z::Enums::StabilityCalcMode _stabilityCalcMode = Z::Enums::StabilityCalcMode::Normal;
 
+    bool _isReal = false;
+
 private:
+    /// Products of runs of constant matrices and pointers to matrices of varied elements,
+    /// that `multMatrix()` uses instead of `_matrsT` and `_matrsS` after setVariedElements().
+    Z::MatrixArray _sweepMatrsT, _sweepMatrsS;
+    QVector<Z::Matrix> _cachedT, _cachedS;
+    bool _hasVariedElems = false;
+
+    Z::MatrixProductTree _treeT, _treeS;
+    QList<Element*> _treeDisabledElems;
+
     /// Array of elements in order of round-trip.
     /// Valid only after calcRoundTrip() call.
     QVector<RoundTripElemInfo> _roundTrip;
@@ -92,8 +145,9 @@ private:
     void calcRoundTripSP();
     void collectMatrices();
     void collectMatricesSP();
+    void checkIsReal();
 
-    double calcStability(const Z::Matrix &m) const;
+    static double calcStability(const Z::Matrix &m, Z::Enums::StabilityCalcMode mode);
     bool isStable(const Z::Matrix &m) const;
 };
 
@@ -1,56 +1,347 @@
 #include "StabilityMap2DFunction.h"
 
+#include "EvalContext.h"
+#include "FunctionUtils.h"
+#include "OpticalProgram.h"
 #include "RoundTripCalculator.h"
 
 #include "../CustomPrefs.h"
 
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// Everything the job needs besides of the schema, it's taken when the job is prepared.
+/// The job calculates into its own buffers, so options of the function can be changed
+/// and a new job can be started while the previous one is still running.
+struct StabilityMap2DFunction::JobData
+{
+    typedef std::function<void(int worker, int ix, int iy)> CalcPointFunc;
+
+    Z::PlottingRange rangeX, rangeY;
+    int nx, ny;
+    bool adaptive;
+    int adaptiveCellSize;
+    double adaptiveTolerance;
+    Z::Enums::StabilityCalcMode stabilityCalcMode;
+    QVector<double> resultsT, resultsS;
+    int evaluations = 0;
+
+    void calcPoints(int threadCount, const std::atomic<bool>& cancelled, const CalcPointFunc& calcPoint);
+    void calcAdaptive(const std::atomic<bool>& cancelled, const CalcPointFunc& calcPoint);
+    bool isStableValue(double v) const;
+    bool isStableRange(double minV, double maxV) const;
+};
+
 void StabilityMap2DFunction::calculate()
 {
-    if (!checkArg(&_paramX)) return;
-    if (!checkArg(&_paramY)) return;
+    auto job = prepareJob();
+    if (job)
+    {
+        std::atomic<bool> cancelled(false);
+        job(cancelled);
+        finishJob();
+    }
+}
+
+void StabilityMap2DFunction::finishJob()
+{
+    if (!_jobData) return;
 
-    ElementEventsLocker elemLockX(_paramX.element);
-    ElementEventsLocker elemLockY(_paramY.element);
-    Z::ParamValueBackup paramLockX(_paramX.parameter);
-    Z::ParamValueBackup paramLockY(_paramY.parameter);
+    _rangeX = _jobData->rangeX;
+    _rangeY = _jobData->rangeY;
+    _resultsT = std::move(_jobData->resultsT);
+    _resultsS = std::move(_jobData->resultsS);
+    _evaluations = _jobData->evaluations;
+    _jobData.reset();
+}
+
+PlotFunction::Job StabilityMap2DFunction::prepareJob()
+{
+    _jobData.reset();
 
-    _rangeX = _paramX.range.plottingRange();
-    _rangeY = _paramY.range.plottingRange();
+    setError(QString());
+    if (!checkArg(&_paramX)) return Job();
+    if (!checkArg(&_paramY)) return Job();
 
-    if (!prepareCalculator(_paramX.element)) return;
+    if (!prepareCalculator(_paramX.element)) return Job();
     _calc->setStabilityCalcMode(stabilityCalcMode());
+    _calc->multMatrix();
+
+    std::shared_ptr<JobData> data(new JobData);
+    data->rangeX = _paramX.range.plottingRange();
+    data->rangeY = _paramY.range.plottingRange();
+    data->nx = data->rangeX.points();
+    data->ny = data->rangeY.points();
+    data->adaptive = _adaptive;
+    data->adaptiveCellSize = _adaptiveCellSize;
+    data->adaptiveTolerance = _adaptiveTolerance;
+    data->stabilityCalcMode = _stabilityCalcMode;
+    data->resultsT.resize(data->nx * data->ny);
+    data->resultsS.resize(data->nx * data->ny);
+    _jobData = data;
+
+    int nx = data->nx;
+    int ny = data->ny;
+    auto unitX = data->rangeX.unit();
+    auto unitY = data->rangeY.unit();
+    auto valuesX = data->rangeX.values();
+    auto valuesY = data->rangeY.values();
+    auto mode = data->stabilityCalcMode;
+    double* resultsT = data->resultsT.data();
+    double* resultsS = data->resultsS.data();
+
+    // Each worker calculates whole rows using its own copy of the round-trip,
+    // and each point is calculated the same way regardless of the number of workers.
+    // Adaptive refinement is serial, so only one worker is needed.
+    int threadCount = data->adaptive ? 1 : FunctionUtils::calcThreadCount(nx);
+
+    // Everything reading the schema or the function is done above, the jobs below
+    // only use compiled programs, isolated contexts and the job data, and can be run in any thread.
+
+    OpticalProgram program;
+    if (program.compile(_calc, {_paramX.element, _paramY.element}))
+    {
+        int slotX = program.slot(_paramX.parameter);
+        int slotY = program.slot(_paramY.parameter);
+        OpticalProgram partX, partY;
+        if (slotX >= 0 && slotY >= 0 && slotX != slotY && program.split(slotX, slotY, partX, partY))
+        {
+            return [=](const std::atomic<bool>& cancelled) mutable {
+                // The round-trip is separable, its parts are calculated once per column and per row,
+                // and only their product is calculated for each point
+                QVector<Z::RealMatrix> partsXT(nx), partsXS(nx), partsYT(ny), partsYS(ny);
+                for (int ix = 0; ix < nx; ix++)
+                {
+                    partX.setSlot(slotX, unitX->toSi(valuesX.at(ix)));
+                    partX.run();
+                    partsXT[ix] = partX.realMt();
+                    partsXS[ix] = partX.realMs();
+                }
+                for (int iy = 0; iy < ny; iy++)
+                {
+                    partY.setSlot(slotY, unitY->toSi(valuesY.at(iy)));
+                    partY.run();
+                    partsYT[iy] = partY.realMt();
+                    partsYS[iy] = partY.realMs();
+                }
+                data->calcPoints(threadCount, cancelled, [&](int, int ix, int iy){
+                    Z::RealMatrix rt(partsXT.at(ix)), rs(partsXS.at(ix));
+                    rt *= partsYT.at(iy);
+                    rs *= partsYS.at(iy);
+                    Z::Matrix mt, ms;
+                    mt.assign(rt.A, rt.B, rt.C, rt.D);
+                    ms.assign(rs.A, rs.B, rs.C, rs.D);
+
+                    auto stab = RoundTripCalculator::stability(mt, ms, mode);
+                    int index = ix * ny + iy;
+                    resultsT[index] = stab.T;
+                    resultsS[index] = stab.S;
+                });
+            };
+        }
+        if (slotX >= 0 && slotY >= 0 && slotX != slotY)
+        {
+            return [=](const std::atomic<bool>& cancelled) {
+                // Index of the last row calculated by each worker, values of X are only set when the row changes
+                std::vector<int> lastX(threadCount, -1);
+                std::vector<OpticalProgram> programs(threadCount, program);
+                data->calcPoints(threadCount, cancelled, [&](int worker, int ix, int iy){
+                    auto& program = programs[worker];
+                    if (lastX[worker] != ix)
+                    {
+                        program.setSlot(slotX, unitX->toSi(valuesX.at(ix)));
+                        lastX[worker] = ix;
+                    }
+                    program.setSlot(slotY, unitY->toSi(valuesY.at(iy)));
+                    program.run();
 
-    int nx = _rangeX.points();
-    int ny = _rangeY.points();
-    auto unitX = _rangeX.unit();
-    auto unitY = _rangeY.unit();
+                    auto stab = RoundTripCalculator::stability(program.Mt(), program.Ms(), mode);
+                    int index = ix * ny + iy;
+                    resultsT[index] = stab.T;
+                    resultsS[index] = stab.S;
+                });
+            };
+        }
+    }
 
-    int pointsCount = nx * ny;
-    if (_resultsT.size() != pointsCount)
+    // Parameters are varied in copies of the schema, the schema itself stays untouched.
+    // Contexts must be created in the schema's thread, they are only used in workers.
+    typedef std::vector<std::unique_ptr<EvalContext>> Contexts;
+    typedef std::vector<std::unique_ptr<RoundTripCalculator>> Calcs;
+    std::shared_ptr<Contexts> contexts(new Contexts);
+    std::shared_ptr<Calcs> calcs(new Calcs);
+    for (int worker = 0; worker < threadCount; worker++)
     {
-        _resultsT.resize(pointsCount);
-        _resultsS.resize(pointsCount);
+        auto context = new EvalContext(_schema);
+        auto calc = new RoundTripCalculator(context->schema(), context->element(_paramX.element));
+        calc->calcRoundTrip();
+        calc->setStabilityCalcMode(mode);
+        calc->setVariedElements({context->element(_paramX.element), context->element(_paramY.element)});
+        contexts->emplace_back(context);
+        calcs->emplace_back(calc);
     }
+    // Source parameters are only used as keys to find their copies in contexts
+    auto paramX = _paramX.parameter;
+    auto paramY = _paramY.parameter;
+
+    return [=](const std::atomic<bool>& cancelled) {
+        std::vector<int> lastX(threadCount, -1);
+        data->calcPoints(threadCount, cancelled, [&](int worker, int ix, int iy){
+            auto context = contexts->at(worker).get();
+            auto calc = calcs->at(worker).get();
+            if (lastX[worker] != ix)
+            {
+                context->setParamValue(paramX, {valuesX.at(ix), unitX});
+                lastX[worker] = ix;
+            }
+            context->setParamValue(paramY, {valuesY.at(iy), unitY});
+
+            calc->multMatrix();
 
-    auto valuesX = _rangeX.values();
-    auto valuesY = _rangeY.values();
+            auto stab = calc->stability();
+            int index = ix * ny + iy;
+            resultsT[index] = stab.T;
+            resultsS[index] = stab.S;
+        });
+    };
+}
 
-    for (int ix = 0; ix < nx; ix++)
+void StabilityMap2DFunction::JobData::calcPoints(int threadCount, const std::atomic<bool>& cancelled, const CalcPointFunc& calcPoint)
+{
+    if (adaptive)
     {
-        _paramX.parameter->setValue({valuesX.at(ix), unitX});
+        calcAdaptive(cancelled, calcPoint);
+        return;
+    }
 
+    FunctionUtils::calcParallel(nx, threadCount, cancelled, [&](int worker, int ix){
         for (int iy = 0; iy < ny; iy++)
+            calcPoint(worker, ix, iy);
+    });
+    evaluations = cancelled ? 0 : nx * ny;
+}
+
+bool StabilityMap2DFunction::JobData::isStableValue(double v) const
+{
+    switch (stabilityCalcMode)
+    {
+    case Z::Enums::StabilityCalcMode::Normal: return v > -1 && v < 1;
+    case Z::Enums::StabilityCalcMode::Squared: return v > 0;
+    }
+    return false;
+}
+
+bool StabilityMap2DFunction::JobData::isStableRange(double minV, double maxV) const
+{
+    switch (stabilityCalcMode)
+    {
+    case Z::Enums::StabilityCalcMode::Normal: return maxV > -1 && minV < 1;
+    case Z::Enums::StabilityCalcMode::Squared: return maxV > 0;
+    }
+    return false;
+}
+
+void StabilityMap2DFunction::JobData::calcAdaptive(const std::atomic<bool>& cancelled, const CalcPointFunc& calcPoint)
+{
+    QVector<bool> calculated(nx * ny, false);
+    evaluations = 0;
+
+    auto calcAt = [&](int ix, int iy) {
+        int index = ix * ny + iy;
+        if (calculated.at(index)) return;
+        calcPoint(0, ix, iy);
+        calculated[index] = true;
+        evaluations++;
+    };
+
+    // The cell must be refined when stability changes within it, or when it has a steep
+    // gradient near the stable region. A narrow stable band can lie between unstable corners,
+    // so only cells whose corner values are all on the same side of the stable region are skipped.
+    auto needsRefine = [&](const double* results, int x0, int x1, int y0, int y1) {
+        double v[4] = { results[x0*ny + y0], results[x0*ny + y1], results[x1*ny + y0], results[x1*ny + y1] };
+        int stableCount = 0;
+        double minV = v[0], maxV = v[0];
+        for (int i = 0; i < 4; i++)
+        {
+            if (std::isnan(v[i])) return true;
+            if (isStableValue(v[i])) stableCount++;
+            minV = qMin(minV, v[i]);
+            maxV = qMax(maxV, v[i]);
+        }
+        if (!isStableRange(minV, maxV)) return false;
+        if (stableCount < 4) return true;
+        return maxV - minV > adaptiveTolerance;
+    };
+
+    // Points inside the cell that are not calculated yet are interpolated from its corners
+    auto interpolate = [&](double* results, int x0, int x1, int y0, int y1) {
+        double v00 = results[x0*ny + y0], v01 = results[x0*ny + y1];
+        double v10 = results[x1*ny + y0], v11 = results[x1*ny + y1];
+        for (int ix = x0; ix <= x1; ix++)
         {
-            _paramY.parameter->setValue({valuesY.at(iy), unitY});
+            double tx = x1 > x0 ? double(ix - x0) / double(x1 - x0) : 0;
+            for (int iy = y0; iy <= y1; iy++)
+            {
+                int index = ix * ny + iy;
+                if (calculated.at(index)) continue;
+                double ty = y1 > y0 ? double(iy - y0) / double(y1 - y0) : 0;
+                results[index] = (v00 * (1 - ty) + v01 * ty) * (1 - tx) + (v10 * (1 - ty) + v11 * ty) * tx;
+            }
+        }
+    };
 
-            _calc->multMatrix();
+    std::function<void(int, int, int, int)> refine = [&](int x0, int x1, int y0, int y1) {
+        if (cancelled) return;
+        calcAt(x0, y0);
+        calcAt(x0, y1);
+        calcAt(x1, y0);
+        calcAt(x1, y1);
+        if (x1 - x0 <= 1 && y1 - y0 <= 1) return;
 
-            auto stab = _calc->stability();
-            int index = ix * ny + iy;
-            _resultsT[index] = stab.T;
-            _resultsS[index] = stab.S;
+        if (!needsRefine(resultsT.data(), x0, x1, y0, y1) &&
+            !needsRefine(resultsS.data(), x0, x1, y0, y1))
+        {
+            interpolate(resultsT.data(), x0, x1, y0, y1);
+            interpolate(resultsS.data(), x0, x1, y0, y1);
+            return;
         }
+
+        QVector<int> xs { x0 }, ys { y0 };
+        if (x1 - x0 > 1) xs << (x0 + x1) / 2;
+        if (y1 - y0 > 1) ys << (y0 + y1) / 2;
+        xs << x1;
+        ys << y1;
+        for (int i = 0; i < xs.size()-1; i++)
+            for (int j = 0; j < ys.size()-1; j++)
+                refine(xs.at(i), xs.at(i+1), ys.at(j), ys.at(j+1));
+    };
+
+    // Coarse grid, the last cells can be smaller than others
+    int cellSize = qMax(1, adaptiveCellSize);
+    for (int x0 = 0; x0 < nx-1; x0 += cellSize)
+        for (int y0 = 0; y0 < ny-1; y0 += cellSize)
+            refine(x0, qMin(x0 + cellSize, nx-1), y0, qMin(y0 + cellSize, ny-1));
+
+    // Degenerated maps having a single row or column
+    if (nx == 1 || ny == 1)
+        for (int ix = 0; ix < nx; ix++)
+            for (int iy = 0; iy < ny; iy++)
+                calcAt(ix, iy);
+}
+
+FunctionInputs StabilityMap2DFunction::inputs() const
+{
+    // Stability depends only on matrices, neither pump nor wavelength are used
+    auto inputs = PlotFunction::inputs();
+    if (!inputs.allElements)
+    {
+        inputs.pump = false;
+        inputs.wavelength = false;
     }
+    return inputs;
 }
 
 void StabilityMap2DFunction::loadPrefs()
@@ -3,6 +3,8 @@
 
 #include "PlotFunction.h"
 
+#include <memory>
+
 class StabilityMap2DFunction : public PlotFunction
 {
 public:
@@ -21,20 +23,44 @@ public:
     const QVector<double>& resultsS() const { return _resultsS; }
 
     void calculate() override;
+    bool canCalculateInBackground() const override { return true; }
+    Job prepareJob() override;
+    void finishJob() override;
     bool hasOptions() const override { return true; }
     bool hasDataTable() const override { return false; }
     void loadPrefs() override;
+    FunctionInputs inputs() const override;
 
     Z::PointTS calculateAt(const Z::Value& x, const Z::Value& y);
 
     Z::Enums::StabilityCalcMode stabilityCalcMode() const { return _stabilityCalcMode; }
     void setStabilityCalcMode(Z::Enums::StabilityCalcMode mode) { _stabilityCalcMode = mode; }
 
+    /// In adaptive mode, the map is calculated on a coarse grid first, and then only cells
+    /// where stability changes or has a steep gradient are recursively subdivided
+    /// down to single points. Other points are interpolated from corners of their cells.
+    bool adaptive() const { return _adaptive; }
+    void setAdaptive(bool on) { _adaptive = on; }
+
+    /// Size of cells of the coarse grid in adaptive mode, in points.
+    int adaptiveCellSize() const { return _adaptiveCellSize; }
+    void setAdaptiveCellSize(int size) { _adaptiveCellSize = size; }
+
+    /// Number of actually calculated points during the last calculation.
+    int evaluations() const { return _evaluations; }
+
 private:
+    struct JobData;
+
     Z::Variable _paramX, _paramY;
     Z::Enums::StabilityCalcMode _stabilityCalcMode = Z::Enums::StabilityCalcMode::Normal;
     QVector<double> _resultsT, _resultsS;
     Z::PlottingRange _rangeX, _rangeY;
+    bool _adaptive = false;
+    int _adaptiveCellSize = 16;
+    double _adaptiveTolerance = 0.1;
+    int _evaluations = 0;
+    std::shared_ptr<JobData> _jobData; ///< Results of the last prepared job, see @ref finishJob().
 
     bool checkArg(Z::Variable* arg);
 };
@@ -2,36 +2,190 @@
 
 #include "../CustomPrefs.h"
 #include "../core/Protocol.h"
+#include "EvalContext.h"
+#include "OpticalProgram.h"
+#include "RootFinder.h"
 #include "RoundTripCalculator.h"
+#include "../core/Format.h"
+
+#include <QApplication>
+#include <QTextStream>
 
 void StabilityMapFunction::calculate()
 {
+    _program.reset();
+    _context.reset();
+    _contextCalc.reset();
+    _samples.clear();
+
     if (!checkArguments()) return;
 
     auto elem = arg()->element;
     auto param = arg()->parameter;
 
-    ElementEventsLocker elemLock(elem);
-    Z::ParamValueBackup paramLock(param);
-
     auto range = arg()->range.plottingRange();
     if (!prepareResults(range)) return;
     if (!prepareCalculator(elem)) return;
     _calc->setStabilityCalcMode(stabilityCalcMode());
+    _calc->multMatrix();
+    _unit = range.unit();
 
-    for (auto x : range.values())
+    _program.reset(new OpticalProgram);
+    _programSlot = _program->compile(_calc, {elem}) ? _program->slot(param) : -1;
+    if (_programSlot < 0)
     {
-        auto value = Z::Value(x, range.unit());
+        _program.reset();
 
-        param->setValue(value);
-        _calc->multMatrix();
-
-        addResultPoint(x, _calc->stability());
+        // Parameter is varied in a copy of the schema, the schema itself stays untouched
+        _context.reset(new EvalContext(_schema));
+        _contextCalc.reset(new RoundTripCalculator(_context->schema(), _context->element(elem)));
+        _contextCalc->calcRoundTrip();
+        _contextCalc->setStabilityCalcMode(stabilityCalcMode());
+        _contextCalc->setVariedElements({_context->element(elem)});
     }
 
+    _samples = samplePoints(range, [this](double x){ return calculatePoint(x); });
+    for (const Sample& sample : qAsConst(_samples))
+        addResultPoint(sample.x, sample.y);
+
     finishResults();
 }
 
+void StabilityMapFunction::evaluate(double x)
+{
+    if (_program)
+    {
+        _program->setSlot(_programSlot, _unit->toSi(x));
+        _program->run();
+    }
+    else
+    {
+        _context->setParamValue(arg()->parameter, Z::Value(x, _unit));
+        _contextCalc->multMatrix();
+    }
+}
+
+Z::PointTS StabilityMapFunction::calculatePoint(double x)
+{
+    evaluate(x);
+    return _program
+            ? _calc->stability(_program->Mt(), _program->Ms())
+            : _contextCalc->stability();
+}
+
+Z::PointTS StabilityMapFunction::calculateHalfTrace(double x)
+{
+    evaluate(x);
+    const Z::Matrix& mt = _program ? _program->Mt() : _contextCalc->Mt();
+    const Z::Matrix& ms = _program ? _program->Ms() : _contextCalc->Ms();
+    // TODO:COMPLEX: what about imaginary part?
+    return { ((mt.A + mt.D) * 0.5).real(), ((ms.A + ms.D) * 0.5).real() };
+}
+
+Z::PairTS<QVector<StabilityMapFunction::StableInterval>> StabilityMapFunction::stableIntervals()
+{
+    Z::PairTS<QVector<StableInterval>> intervals;
+    if (_samples.size() < 2 || (!_program && !_context)) return intervals;
+
+    // Boundaries are where P = (A + D)/2 crosses -1 or +1, the scan in the normal mode
+    // already has values of P, in other modes they are recalculated at the same points
+    QVector<Z::PointTS> halfTraces;
+    halfTraces.reserve(_samples.size());
+    for (const Sample& sample : qAsConst(_samples))
+        halfTraces << (_stabilityCalcMode == Z::Enums::StabilityCalcMode::Normal
+                       ? sample.y : calculateHalfTrace(sample.x));
+
+    struct Crossing
+    {
+        double x;
+        bool enters;
+    };
+
+    for (auto plane : { Z::Plane_T, Z::Plane_S })
+    {
+        auto value = [plane](const Z::PointTS& p){ return plane == Z::Plane_T ? p.T : p.S; };
+        auto isStable = [](double p){ return p > -1 && p < 1; };
+
+        QVector<StableInterval>& res = plane == Z::Plane_T ? intervals.T : intervals.S;
+        double start = isStable(value(halfTraces.first())) ? _samples.first().x : Double::nan();
+        for (int i = 1; i < _samples.size(); i++)
+        {
+            double x1 = _samples.at(i-1).x, x2 = _samples.at(i).x;
+            double p1 = value(halfTraces.at(i-1)), p2 = value(halfTraces.at(i));
+            if (std::isnan(p1) || std::isnan(p2)) continue;
+
+            // Both boundaries can be crossed between two scan points when the stable range is narrow
+            QVector<Crossing> crossings;
+            for (double level : { -1.0, 1.0 })
+            {
+                double f1 = p1 - level, f2 = p2 - level;
+                if ((f1 > 0) == (f2 > 0)) continue;
+                // Scan points are brackets of the boundary, only the root refinement is needed
+                auto f = [&](double x){ return value(calculateHalfTrace(x)) - level; };
+                double x = RootFinder::brent(f, x1, x2, f1, f2);
+                if (std::isnan(x)) x = (x1 + x2) / 2.0;
+                bool enters = level < 0 ? f2 > 0 : f2 < 0;
+                crossings.append({x, enters});
+            }
+            if (crossings.size() == 2 && crossings.at(1).x < crossings.at(0).x)
+                std::swap(crossings[0], crossings[1]);
+
+            for (const Crossing& crossing : qAsConst(crossings))
+            {
+                if (crossing.enters)
+                    start = crossing.x;
+                else if (!std::isnan(start))
+                {
+                    res.append({ _unit->toSi(start), _unit->toSi(crossing.x) });
+                    start = Double::nan();
+                }
+            }
+        }
+        if (!std::isnan(start))
+            res.append({ _unit->toSi(start), _unit->toSi(_samples.last().x) });
+    }
+    return intervals;
+}
+
+QString StabilityMapFunction::calculateNotables()
+{
+    auto intervals = stableIntervals();
+    auto unit = arg()->range.start.unit();
+
+    QString report;
+    QTextStream stream(&report);
+    for (auto plane : { Z::Plane_T, Z::Plane_S })
+    {
+        const auto& planeIntervals = plane == Z::Plane_T ? intervals.T : intervals.S;
+        stream << QStringLiteral("<p><b>%1:</b> ").arg(plane == Z::Plane_T ? "T" : "S");
+        if (planeIntervals.isEmpty())
+            stream << qApp->translate("StabilityMapFunction", "unstable");
+        else
+        {
+            stream << qApp->translate("StabilityMapFunction", "stable in");
+            for (int i = 0; i < planeIntervals.size(); i++)
+                stream << (i > 0 ? QStringLiteral(",") : QString())
+                       << QStringLiteral("<br>&nbsp;&nbsp;%1 %3 .. %2 %3")
+                          .arg(Z::str(unit->fromSi(planeIntervals.at(i).start)),
+                               Z::str(unit->fromSi(planeIntervals.at(i).stop)),
+                               unit->name());
+        }
+    }
+    return report;
+}
+
+FunctionInputs StabilityMapFunction::inputs() const
+{
+    // Stability depends only on matrices, neither pump nor wavelength are used
+    auto inputs = PlotFunction::inputs();
+    if (!inputs.allElements)
+    {
+        inputs.pump = false;
+        inputs.wavelength = false;
+    }
+    return inputs;
+}
+
 void StabilityMapFunction::loadPrefs()
 {
     _stabilityCalcMode = Z::Enums::fromStr(
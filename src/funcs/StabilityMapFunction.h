@@ -4,6 +4,11 @@
 #include "../core/CommonTypes.h"
 #include "PlotFunction.h"
 
+#include <memory>
+
+class EvalContext;
+class OpticalProgram;
+
 class StabilityMapFunction : public PlotFunction
 {
 public:
@@ -15,15 +20,41 @@ public:
 
     void calculate() override;
     bool hasOptions() const override { return true; }
+    bool hasNotables() const override { return true; }
+    QString calculateNotables() override;
     void loadPrefs() override;
+    FunctionInputs inputs() const override;
 
      Z::PointTS calculateAt(const Z::Value& v);
 
     Z::Enums::StabilityCalcMode stabilityCalcMode() const { return _stabilityCalcMode; }
     void setStabilityCalcMode(Z::Enums::StabilityCalcMode mode) { _stabilityCalcMode = mode; }
 
+    struct StableInterval
+    {
+        double start;
+        double stop;
+    };
+
+    /// Finds all ranges of the argument where the system is stable.
+    /// Brackets of boundaries are taken from the last calculated points,
+    /// then boundaries are refined to machine precision. Values are in SI units.
+    Z::PairTS<QVector<StableInterval>> stableIntervals();
+
 private:
     Z::Enums::StabilityCalcMode _stabilityCalcMode = Z::Enums::StabilityCalcMode::Normal;
+
+    // Evaluation state of the last calculation, it's kept for finding boundaries
+    std::shared_ptr<OpticalProgram> _program;
+    int _programSlot = -1;
+    std::shared_ptr<EvalContext> _context;
+    std::shared_ptr<RoundTripCalculator> _contextCalc;
+    Z::Unit _unit = nullptr;
+    QVector<Sample> _samples;
+
+    void evaluate(double x);
+    Z::PointTS calculatePoint(double x);
+    Z::PointTS calculateHalfTrace(double x);
 };
 
 #endif // STABILITY_MAP_FUNCTION_H
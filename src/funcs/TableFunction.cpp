@@ -3,6 +3,7 @@
 #include "AbcdBeamCalculator.h"
 #include "FunctionUtils.h"
 #include "PumpCalculator.h"
+#include "ResultCache.h"
 #include "RoundTripCalculator.h"
 #include "../AppSettings.h"
 #include "../core/Schema.h"
@@ -47,6 +48,14 @@ TableFunction::TableFunction(Schema *schema) : FunctionBase(schema)
 {
 }
 
+FunctionInputs TableFunction::inputs() const
+{
+    FunctionInputs inputs;
+    inputs.pump = !ok() || !_schema->isResonator();
+    inputs.globalParams = false;
+    return inputs;
+}
+
 bool TableFunction::prepareSinglePass()
 {
     QString res = FunctionUtils::preparePumpCalculator(schema(), nullptr, _pumpCalc);
@@ -66,6 +75,70 @@ bool TableFunction::prepareResonator()
     return true;
 }
 
+void TableFunction::preparePropagation()
+{
+    _propagationIndex.clear();
+    _headT.clear();
+    _headS.clear();
+    _tailT.clear();
+    _tailS.clear();
+
+    if (!propagate || _schema->count() == 0) return;
+
+    // Round-trip from any element is a cyclic shift of the round-trip from the first one,
+    // and in SP schemas matrix from the input to any element is a tail of matrix to the last one.
+    // So products of heads and tails of a single round-trip give matrices for all points.
+    auto ref = _schema->isResonator() ? _schema->element(0) : _schema->element(_schema->count()-1);
+    RoundTripCalculator calc(schema(), ref);
+    calc.calcRoundTrip();
+
+    const auto& roundTrip = calc.rawRoundTrip();
+    for (int i = 0; i < roundTrip.size(); i++)
+        if (!roundTrip.at(i).secondPass)
+            _propagationIndex[roundTrip.at(i).element] = i;
+
+    const auto& matrsT = calc.matrsT();
+    const auto& matrsS = calc.matrsS();
+    const int count = matrsT.size();
+    _headT.resize(count+1);
+    _headS.resize(count+1);
+    _tailT.resize(count+1);
+    _tailS.resize(count+1);
+    for (int i = 0; i < count; i++)
+    {
+        _headT[i+1] = _headT.at(i) * *matrsT.at(i);
+        _headS[i+1] = _headS.at(i) * *matrsS.at(i);
+    }
+    for (int i = count-1; i >= 0; i--)
+    {
+        _tailT[i] = *matrsT.at(i) * _tailT.at(i+1);
+        _tailS[i] = *matrsS.at(i) * _tailS.at(i+1);
+    }
+}
+
+void TableFunction::propagatedMatrices(const CalcElem& calcElem, Z::Matrix& mt, Z::Matrix& ms) const
+{
+    const int index = _propagationIndex.value(calcElem.ref());
+    const bool isResonator = _schema->isResonator();
+
+    if (!calcElem.range)
+    {
+        // The same round-trip as RoundTripCalculator makes starting from the element
+        mt = isResonator ? _tailT.at(index) * _headT.at(index) : _tailT.at(index);
+        ms = isResonator ? _tailS.at(index) * _headS.at(index) : _tailS.at(index);
+        return;
+    }
+
+    // Matrix of the range is replaced with its parts, the same as when splitRange is used
+    mt = calcElem.range->Mt1() * _tailT.at(index+1);
+    ms = calcElem.range->Ms1() * _tailS.at(index+1);
+    if (isResonator)
+    {
+        mt = mt * _headT.at(index) * calcElem.range->Mt2();
+        ms = ms * _headS.at(index) * calcElem.range->Ms2();
+    }
+}
+
 void TableFunction::calculate()
 {
     _results.clear();
@@ -77,6 +150,20 @@ void TableFunction::calculate()
            : prepareSinglePass();
     if (!isPrepared) return;
 
+    // Results reference elements, so they can be reused only for exactly the same ones
+    ResultCache::Key key;
+    key << alias() << int(_schema->tripType()) << _schema->wavelength().value()
+        << calcMediumEnds << calcEmptySpaces << propagate;
+    for (auto elem : schema()->elements())
+        key.addIdentity(elem) << elem;
+    if (!isResonator)
+        key << _schema->activePump();
+    auto cacheKey = key.result();
+    if (ResultCache::instance().take(cacheKey, _results))
+        return;
+
+    preparePropagation();
+
     #define CHECK_ERR(f) {\
         QString res = f;\
         if (!res.isEmpty()) {\
@@ -148,7 +235,13 @@ void TableFunction::calculate()
     {
         Z_ERROR(name() + ": " + _errorText)
         _results.clear();
+        return;
     }
+
+    int cost = 0;
+    for (const Result& result : qAsConst(_results))
+        cost += result.values.size() * int(sizeof(Z::PointTS)) + 64;
+    ResultCache::instance().put(cacheKey, _results, cost);
 }
 
 Element* TableFunction::prevElement(int index)
@@ -399,9 +492,17 @@ void TableFunction::calculateAt(CalcElem calcElem, ResultElem resultElem, Option
             calcElem.range->setSubRangeSI(calcElem.subrange);
     }
 
-    RoundTripCalculator calc(schema(), calcElem.ref());
-    calc.calcRoundTrip(calcElem.range);
-    calc.multMatrix();
+    Z::Matrix mt, ms;
+    if (propagate && _propagationIndex.contains(calcElem.ref()))
+        propagatedMatrices(calcElem, mt, ms);
+    else
+    {
+        RoundTripCalculator calc(schema(), calcElem.ref());
+        calc.calcRoundTrip(calcElem.range);
+        calc.multMatrix();
+        mt = calc.Mt();
+        ms = calc.Ms();
+    }
 
     const double ior = overrideIor.set ? overrideIor.value : (calcElem.range ? calcElem.range->ior() : 1);
 
@@ -409,8 +510,8 @@ void TableFunction::calculateAt(CalcElem calcElem, ResultElem resultElem, Option
     res.element = resultElem.elem;
     res.position = resultElem.pos;
     res.values = schema()->isResonator()
-            ? calculateResonator(&calc, ior)
-            : calculateSinglePass(&calc, ior);
+            ? calculateResonator(mt, ms, ior)
+            : calculateSinglePass(mt, ms, ior);
     _results << res;
 }
 
@@ -431,10 +532,10 @@ void TableFunction::calculatePumpBeforeSchema(Element* elem, ResultPosition resu
     _results << res;
 }
 
-QVector<Z::PointTS> TableFunction::calculateSinglePass(RoundTripCalculator* calc, double ior) const
+QVector<Z::PointTS> TableFunction::calculateSinglePass(const Z::Matrix& mt, const Z::Matrix& ms, double ior) const
 {
-    BeamResult beamT = _pumpCalc.T->calc(calc->Mt(), ior);
-    BeamResult beamS = _pumpCalc.S->calc(calc->Ms(), ior);
+    BeamResult beamT = _pumpCalc.T->calc(mt, ior);
+    BeamResult beamS = _pumpCalc.S->calc(ms, ior);
     return {
         { beamT.beamRadius, beamS.beamRadius },
         { beamT.frontRadius, beamS.frontRadius },
@@ -442,12 +543,12 @@ QVector<Z::PointTS> TableFunction::calculateSinglePass(RoundTripCalculator* calc
     };
 }
 
-QVector<Z::PointTS> TableFunction::calculateResonator(RoundTripCalculator *calc, double ior) const
+QVector<Z::PointTS> TableFunction::calculateResonator(const Z::Matrix& mt, const Z::Matrix& ms, double ior) const
 {
     return {
-        _beamCalc->beamRadius(calc->Mt(), calc->Ms(), ior),
-        _beamCalc->frontRadius(calc->Mt(), calc->Ms(), ior),
-        _beamCalc->halfAngle(calc->Mt(), calc->Ms(), ior),
+        _beamCalc->beamRadius(mt, ms, ior),
+        _beamCalc->frontRadius(mt, ms, ior),
+        _beamCalc->halfAngle(mt, ms, ior),
     };
 }
 
@@ -94,6 +94,10 @@ public:
 
     virtual QVector<ColumnDef> columns() const;
 
+    /// Function calculates beam at each element, so it depends on all of them.
+    /// Pump is only used in single-pass schemas.
+    FunctionInputs inputs() const override;
+
     const QVector<Result>& results() const { return _results; }
 
     /// Calculate additional points which are excessive for user
@@ -102,14 +106,30 @@ public:
     bool calcMediumEnds = false;
     bool calcEmptySpaces = false;
 
+    /// Matrices for all points are taken from products of round-trip parts
+    /// calculated once per schema, see @ref preparePropagation().
+    /// When disabled, a separate round-trip is calculated for each point,
+    /// that costs O(N²) matrix products but can be useful for testing.
+    bool propagate = true;
+
 protected:
     QString _errorText;
     QVector<Result> _results;
     Z::PairTS<std::shared_ptr<PumpCalculator>> _pumpCalc;
     std::shared_ptr<AbcdBeamCalculator> _beamCalc;
 
+    /// Index of matrix of each element in the round-trip collected by @ref preparePropagation().
+    /// In SW schemas it is the index of pass in the same direction as the table goes.
+    QMap<Element*, int> _propagationIndex;
+
+    /// Products of the leading and trailing parts of the collected round-trip.
+    /// `_headT[i]` is a product of matrices [0, i) and `_tailT[i]` is a product of [i, N).
+    QVector<Z::Matrix> _headT, _headS, _tailT, _tailS;
+
     bool prepareSinglePass();
     bool prepareResonator();
+    void preparePropagation();
+    void propagatedMatrices(const CalcElem& calcElem, Z::Matrix& mt, Z::Matrix& ms) const;
     Element* prevElement(int index);
     Element* nextElement(int index);
     QString calculateAtElem(Element* elem, int index, AlwaysTwoSides alwaysTwoSides);
@@ -119,8 +139,8 @@ protected:
     QString calculateInMiddle(Element* elem, Element *prevElem, Element *nextElem, AlwaysTwoSides alwaysTwoSides);
     void calculateAt(CalcElem calcElem, ResultElem resultElem, OptionalIor overrideIor = OptionalIor());
     void calculatePumpBeforeSchema(Element* elem, ResultPosition resultPos);
-    QVector<Z::PointTS> calculateSinglePass(RoundTripCalculator* calc, double ior) const;
-    QVector<Z::PointTS> calculateResonator(RoundTripCalculator* calc, double ior) const;
+    QVector<Z::PointTS> calculateSinglePass(const Z::Matrix& mt, const Z::Matrix& ms, double ior) const;
+    QVector<Z::PointTS> calculateResonator(const Z::Matrix& mt, const Z::Matrix& ms, double ior) const;
 };
 
 #endif // TABLEFUNCTION_H
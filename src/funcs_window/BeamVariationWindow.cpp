@@ -3,6 +3,7 @@
 #include "../CustomPrefs.h"
 #include "../core/Format.h"
 #include "../io/JsonUtils.h"
+#include "../io/SchemaReaderJson.h"
 #include "../widgets/ElemSelectorWidget.h"
 #include "../widgets/VariableRangeEditor.h"
 
@@ -160,21 +161,7 @@ Z::Unit BeamVariationWindow::getDefaultUnitY() const
 
 QString BeamVariationWindow::readFunction(const QJsonObject& root)
 {
-    auto res = Z::IO::Json::readVariable(root["arg"].toObject(), function()->arg(), schema());
-    if (!res.isEmpty())
-        return res;
-
-    auto pos = root["pos"].toObject();
-
-    auto elem = Z::IO::Json::readElemByIndex(pos, "element_index", schema());
-    if (!elem.ok()) return elem.error();
-
-    auto offset = Z::IO::Json::readValue(pos["offset"].toObject());
-    if (!offset.ok()) return offset.error();
-
-    function()->pos()->element = elem.value();
-    function()->pos()->offset = offset.value();
-    return QString();
+    return Z::IO::Json::readFunction(root, function(), schema());
 }
 
 QString BeamVariationWindow::writeFunction(QJsonObject& root)
@@ -4,9 +4,11 @@
 #include "../AppSettings.h"
 #include "../CustomPrefs.h"
 #include "../core/Format.h"
+#include "../core/Schema.h"
 #include "../funcs/FunctionGraph.h"
 #include "../io/CommonUtils.h"
 #include "../io/JsonUtils.h"
+#include "../io/SchemaReaderJson.h"
 #include "../widgets/BeamShapeWidget.h"
 #include "../widgets/ElemSelectorWidget.h"
 #include "../widgets/VariableRangeEditor.h"
@@ -110,8 +112,15 @@ CausticWindow::CausticWindow(Schema *schema) : PlotFuncWindowStorable(new Causti
     _actnShowBeamShape->setVisible(false);
     connect(_actnShowBeamShape, &QAction::triggered, this, &CausticWindow::showBeamShape);
 
+    _actnAdaptive = new QAction(tr("Adaptive Points", "Plot action"), this);
+    _actnAdaptive->setToolTip(tr("Add points where the graph changes rapidly, "
+                                 "e.g. near the waist"));
+    _actnAdaptive->setCheckable(true);
+    connect(_actnAdaptive, &QAction::triggered, this, &CausticWindow::toggleAdaptive);
+
     menuPlot->addSeparator();
     menuPlot->addAction(_actnShowBeamShape);
+    menuPlot->addAction(_actnAdaptive);
 
     toolbar()->addSeparator();
     toolbar()->addAction(_actnShowBeamShape);
@@ -133,17 +142,15 @@ QWidget* CausticWindow::makeOptionsPanel()
 
 QString CausticWindow::readFunction(const QJsonObject& root)
 {
-    function()->setMode(Z::IO::Utils::enumFromStr(
-        root["mode"].toString(), CausticFunction::BeamRadius));
-    auto res = Z::IO::Json::readVariable(root["arg"].toObject(), function()->arg(), schema());
-    if (!res.isEmpty())
-        return res;
-    return QString();
+    auto res = Z::IO::Json::readFunction(root, function(), schema());
+    _actnAdaptive->setChecked(function()->adaptive());
+    return res;
 }
 
 QString CausticWindow::writeFunction(QJsonObject& root)
 {
     root["mode"] = Z::IO::Utils::enumToStr(function()->mode());
+    root["adaptive"] = function()->adaptive();
     root["arg"] = Z::IO::Json::writeVariable(function()->arg(), schema());
     return QString();
 }
@@ -214,6 +221,13 @@ QString CausticWindow::getCursorInfo(const QPointF& pos) const
             .arg(Z::format(unitY->fromSi(res.S)));
 }
 
+void CausticWindow::toggleAdaptive()
+{
+    function()->setAdaptive(_actnAdaptive->isChecked());
+    schema()->markModified("CausticWindow::toggleAdaptive");
+    update();
+}
+
 void CausticWindow::showBeamShape()
 {
     if (_beamShape)
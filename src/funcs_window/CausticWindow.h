@@ -34,11 +34,12 @@ protected:
     QString writeFunction(QJsonObject& root) override;
 
 private:
-    QAction *_actnShowBeamShape;
+    QAction *_actnShowBeamShape, *_actnAdaptive;
     BeamShapeWidget *_beamShape = nullptr;
     QRect _beamShapeGeom;
 
     void showBeamShape();
+    void toggleAdaptive();
 };
 
 
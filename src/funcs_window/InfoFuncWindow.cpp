@@ -68,7 +68,7 @@ InfoFuncWindow::~InfoFuncWindow()
 
 void InfoFuncWindow::createToolbar()
 {
-    actnUpdate = Ori::Gui::action(tr("Update"), this, SLOT(processCalc()), ":/toolbar/update", QKeySequence::Refresh);
+    actnUpdate = Ori::Gui::action(tr("Update"), this, SLOT(recalculate()), ":/toolbar/update", QKeySequence::Refresh);
     actnFreeze = Ori::Gui::toggledAction(tr("Freeze"), this, SLOT(freeze(bool)), ":/toolbar/freeze", QKeySequence::Find);
     auto actnCopy = Ori::Gui::action(tr("Copy"), _editor, SLOT(copy()), ":/toolbar/copy", QKeySequence::Copy);
     auto actnCopyAll = Ori::Gui::action(tr("Copy All"), this, SLOT(copyAll()), ":/toolbar/copy_all");
@@ -137,11 +137,25 @@ void InfoFuncWindow::elementDeleting(Schema*, Element *elem)
     }
 }
 
+bool InfoFuncWindow::recalcAffectedBy(Schema*, const SchemaChanges& changes)
+{
+    if (!_function->isAffectedBy(changes)) return false;
+    _function->collectChanges(changes);
+    return true;
+}
+
 void InfoFuncWindow::processCalc()
 {
     _function->calculate();
 }
 
+void InfoFuncWindow::recalculate()
+{
+    // Update is requested by user, don't trust previously collected changes
+    _function->resetChanges();
+    processCalc();
+}
+
 void InfoFuncWindow::freeze(bool frozen)
 {
     actnUpdate->setEnabled(!frozen);
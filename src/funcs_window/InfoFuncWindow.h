@@ -24,6 +24,7 @@ public:
 
 protected:
     void recalcRequired(Schema*) override { processCalc(); }
+    bool recalcAffectedBy(Schema*, const SchemaChanges& changes) override;
     void elementDeleting(Schema*, Element*) override;
     void functionCalculated(FunctionBase*) override;
     void functionDeleted(FunctionBase*) override;
@@ -32,6 +33,7 @@ private slots:
     void freeze(bool);
     void help();
     void processCalc();
+    void recalculate();
     void linkClicked(const class QUrl&);
     void copyAll();
 
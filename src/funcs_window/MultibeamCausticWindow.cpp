@@ -41,11 +41,10 @@ void MultibeamCausticWindow::calculate()
 
     clearStatusInfo();
     int errorCount = 0;
+    function()->calculatePumps(*schema()->pumps());
     for (auto pump : *schema()->pumps())
     {
-        function()->setPump(pump);
-        function()->calculate();
-        if (!function()->ok())
+        if (!function()->selectPump(pump))
         {
             errorCount++;
             Z_ERROR(QString("%1: Pump %2: %3").arg(windowTitle()).arg(pump->label()).arg(function()->errorText()));
@@ -5,6 +5,7 @@
 #include "../funcs/FunctionGraph.h"
 #include "../funcs/PlotFuncRoundTripFunction.h"
 #include "../io/JsonUtils.h"
+#include "../io/SchemaReaderJson.h"
 #include "../widgets/BeamShapeWidget.h"
 
 #include "qcpl_cursor.h"
@@ -116,18 +117,7 @@ ElemDeletionReaction MulticausticWindow::reactElemDeletion(const Elements& elems
 
 QString MulticausticWindow::readFunction(const QJsonObject& root)
 {
-    QVector<Z::Variable> args;
-    QJsonArray argsJson = root["args"].toArray();
-    for (auto it = argsJson.begin(); it != argsJson.end(); it++)
-    {
-        Z::Variable arg;
-        auto res = Z::IO::Json::readVariable((*it).toObject(), &arg, schema());
-        if (!res.isEmpty())
-            return res;
-        args.append(arg);
-    }
-    function()->setArgs(args);
-    return QString();
+    return Z::IO::Json::readFunction(root, function(), schema());
 }
 
 QString MulticausticWindow::writeFunction(QJsonObject& root)
@@ -17,16 +17,6 @@ QWidget* MultirangeCausticWindow::makeOptionsPanel()
     return new CausticOptionsPanel<MultirangeCausticWindow>(this);
 }
 
-QString MultirangeCausticWindow::readFunction(const QJsonObject& root)
-{
-    QString res = MulticausticWindow::readFunction(root);
-    if (!res.isEmpty()) return res;
-
-    function()->setMode(Z::IO::Utils::enumFromStr(
-        root["mode"].toString(), CausticFunction::BeamRadius));
-    return QString();
-}
-
 QString MultirangeCausticWindow::writeFunction(QJsonObject& root)
 {
     MulticausticWindow::writeFunction(root);
@@ -19,7 +19,6 @@ protected:
     QString getCursorInfo(const QPointF& pos) const override;
 
     // Implementation of PlotFuncWindowStorable
-    QString readFunction(const QJsonObject& root) override;
     QString writeFunction(QJsonObject& root) override;
 };
 
@@ -23,6 +23,9 @@
 #include "qcpl_graph_grid.h"
 #include "qcpl_plot.h"
 
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
 using namespace Ori::Gui;
 
 enum PlotWindowStatusPanels
@@ -48,6 +51,7 @@ PlotFuncWindow::PlotFuncWindow(PlotFunction *func) : SchemaMdiChild(func->schema
 
 PlotFuncWindow::~PlotFuncWindow()
 {
+    stopJob();
     delete _function;
     delete _graphs;
 }
@@ -301,7 +305,10 @@ void PlotFuncWindow::updateModeTS()
     }
     else
     {
-        updateGraphs();
+        // Function results are incomplete while it's being calculated,
+        // graphs will be updated when the calculation is finished
+        if (!isJobRunning())
+            updateGraphs();
         afterUpdate();
         _plot->replot();
     }
@@ -408,8 +415,18 @@ void PlotFuncWindow::update()
         return;
     }
 
+    if (_function->canCalculateInBackground())
+    {
+        startJob();
+        return;
+    }
+
     calculate();
+    updateAfterCalculation();
+}
 
+void PlotFuncWindow::updateAfterCalculation()
+{
     if (_autolimitsRequest)
     {
         _autolimitsRequest = false;
@@ -435,6 +452,11 @@ void PlotFuncWindow::update()
 void PlotFuncWindow::calculate()
 {
     _function->calculate();
+    showCalculated();
+}
+
+void PlotFuncWindow::showCalculated()
+{
     if (!_function->ok())
     {
         showStatusError(_function->errorText());
@@ -447,6 +469,53 @@ void PlotFuncWindow::calculate()
     }
 }
 
+void PlotFuncWindow::startJob()
+{
+    // A newer calculation makes the running one stale, it's cancelled but not waited for,
+    // it calculates into its own buffers and finishes in background without touching the function.
+    stopJob();
+
+    auto job = _function->prepareJob();
+    if (!job)
+    {
+        showCalculated();
+        updateAfterCalculation();
+        return;
+    }
+
+    // Previous graphs are still shown until the new ones are calculated
+    _statusBar->setText(STATUS_INFO, tr("Calculating..."));
+
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    _jobCancelled = cancelled;
+    _job = new QFutureWatcher<void>(this);
+    connect(_job, &QFutureWatcher<void>::finished, this, &PlotFuncWindow::jobFinished);
+    _job->setFuture(QtConcurrent::run([job, cancelled]{ job(*cancelled); }));
+}
+
+void PlotFuncWindow::stopJob()
+{
+    if (!_job) return;
+
+    *_jobCancelled = true;
+    disconnect(_job, nullptr, this, nullptr);
+    if (_job->isFinished())
+        _job->deleteLater();
+    else
+        connect(_job, &QFutureWatcher<void>::finished, _job, &QObject::deleteLater);
+    _job = nullptr;
+}
+
+void PlotFuncWindow::jobFinished()
+{
+    _job->deleteLater();
+    _job = nullptr;
+
+    _function->finishJob();
+    showCalculated();
+    updateAfterCalculation();
+}
+
 void PlotFuncWindow::showStatusError(const QString& message)
 {
     _statusBar->setText(STATUS_INFO, message);
@@ -506,6 +575,7 @@ QWidget* PlotFuncWindow::optionsPanelRequired()
 
 bool PlotFuncWindow::configure()
 {
+    stopJob();
     bool ok = configureInternal();
     if (ok)
         schema()->events().raise(SchemaEvents::Changed, "PlotFuncWindow: configure");
@@ -563,6 +633,7 @@ void PlotFuncWindow::elementDeleting(Schema*, Element* elem)
 
 void PlotFuncWindow::disableAndClose()
 {
+    stopJob();
     _frozen = true; // disable updates
     QTimer::singleShot(0, [this]{this->close();});
 }
@@ -9,7 +9,11 @@
 
 #include "qcpl_types.h"
 
+#include <atomic>
+#include <memory>
+
 QT_BEGIN_NAMESPACE
+template <typename T> class QFutureWatcher;
 class QAction;
 class QLabel;
 class QSplitter;
@@ -61,12 +65,17 @@ public:
     /// Edits function parameters through dialog.
     bool configure();
 
+    /// Cancels the calculation running in background, if any, without waiting for it.
+    /// Should be called before changing function options, then the window must be updated.
+    void stopJob();
+
     // inherits from BasicMdiChild
     QList<QMenu*> menus() override { return QList<QMenu*>() << menuPlot << menuLimits /* TODO:NEXT-VER << menuFormat*/; }
     virtual QList<ViewMenuItem> menuItems_View() override;
 
     // Implementation of SchemaListener
     void recalcRequired(Schema*) override { update(); }
+    bool recalcAffectedBy(Schema*, const SchemaChanges& changes) override { return _function->isAffectedBy(changes); }
     void elementDeleting(Schema*, Element*) override;
 
     void storeView(int key);
@@ -108,6 +117,8 @@ protected:
     bool _frozen = false;
     bool _exclusiveModeTS = false;
     bool _recalcWhenChangeModeTS = false;
+    QFutureWatcher<void>* _job = nullptr; ///< Calculation running in background.
+    std::shared_ptr<std::atomic<bool>> _jobCancelled;
     UnitsMenu *_unitsMenuX, *_unitsMenuY;
     QMenu *menuPlot, *menuLimits, *menuFormat;
     QAction *actnShowT, *actnShowS, *actnShowFlippedTS,
@@ -161,6 +172,10 @@ protected:
     void showStatusError(const QString &message);
     void clearStatusInfo();
 
+    void showCalculated();
+    void startJob();
+    bool isJobRunning() const { return _job; }
+
     void disableAndClose();
 
     Z::Unit getUnitX() const;
@@ -174,12 +189,14 @@ private slots:
     void activateModeFlippedTS();
     void updateWithParams();
     void freeze(bool);
+    void jobFinished();
     void copyPlotImage();
     void copyGraphData();
 
     QWidget* optionsPanelRequired();
 
 private:
+    void updateAfterCalculation();
     void setUnitX(Z::Unit unit);
     void setUnitY(Z::Unit unit);
 
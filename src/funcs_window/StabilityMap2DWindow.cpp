@@ -3,8 +3,10 @@
 #include "FuncOptionsPanel.h"
 #include "../CustomPrefs.h"
 #include "../core/Format.h"
+#include "../core/Schema.h"
 #include "../io/CommonUtils.h"
 #include "../io/JsonUtils.h"
+#include "../io/SchemaReaderJson.h"
 #include "../widgets/ElemSelectorWidget.h"
 #include "../widgets/VariableRangeEditor.h"
 #include "../widgets/PlotHelpers.h"
@@ -168,6 +170,7 @@ void StabilityMap2DOptionsPanel::functionModeChanged(int mode)
 {
     auto stabCalcMode = static_cast<Z::Enums::StabilityCalcMode>(mode);
     CustomPrefs::setRecentStr(QStringLiteral("func_stab_2d_map_mode"), Z::Enums::toStr(stabCalcMode));
+    _window->stopJob();
     _window->function()->setStabilityCalcMode(stabCalcMode);
 }
 
@@ -223,6 +226,15 @@ void StabilityMap2DWindow::createControl()
     _plot->menuAxisX->insertAction(actnCopyPlotImage, _actnCopyGraphData);
     _plot->menuAxisY->insertAction(actnCopyPlotImage, _actnCopyGraphData);
 
+    _actnAdaptive = new QAction(tr("Adaptive Calculation", "Plot action"), this);
+    _actnAdaptive->setToolTip(tr("Calculate in full resolution only near stability boundaries, "
+                                 "interpolate values elsewhere"));
+    _actnAdaptive->setCheckable(true);
+    connect(_actnAdaptive, &QAction::triggered, this, &StabilityMap2DWindow::toggleAdaptive);
+
+    menuPlot->addSeparator();
+    menuPlot->addAction(_actnAdaptive);
+
     menuLimits->addSeparator();
     menuLimits->addAction(_actnStabilityAutolimits);
 
@@ -364,18 +376,15 @@ void StabilityMap2DWindow::restoreViewSpecific(int key)
 
 QString StabilityMap2DWindow::readFunction(const QJsonObject& root)
 {
-    function()->setStabilityCalcMode(Z::IO::Utils::enumFromStr(
-        root["stab_calc_mode"].toString(), Z::Enums::StabilityCalcMode::Normal));
-    auto resX = Z::IO::Json::readVariable(root["arg_x"].toObject(), function()->paramX(), schema());
-    if (!resX.isEmpty()) return resX;
-    auto resY = Z::IO::Json::readVariable(root["arg_y"].toObject(), function()->paramY(), schema());
-    if (!resY.isEmpty()) return resY;
-    return QString();
+    auto res = Z::IO::Json::readFunction(root, function(), schema());
+    _actnAdaptive->setChecked(function()->adaptive());
+    return res;
 }
 
 QString StabilityMap2DWindow::writeFunction(QJsonObject& root)
 {
     root["stab_calc_mode"] = Z::IO::Utils::enumToStr(function()->stabilityCalcMode());
+    root["adaptive"] = function()->adaptive();
     root["arg_x"] = Z::IO::Json::writeVariable(function()->paramX(), schema());
     root["arg_y"] = Z::IO::Json::writeVariable(function()->paramY(), schema());
     return QString();
@@ -440,6 +449,14 @@ QString StabilityMap2DWindow::getCursorInfo(const QPointF& pos) const
     return QStringLiteral("Pt = %1; Ps = %2").arg(Z::format(res.T), Z::format(res.S));
 }
 
+void StabilityMap2DWindow::toggleAdaptive()
+{
+    stopJob();
+    function()->setAdaptive(_actnAdaptive->isChecked());
+    schema()->markModified("StabilityMap2DWindow::toggleAdaptive");
+    update();
+}
+
 void StabilityMap2DWindow::copyGraphData2D()
 {
     auto settings = PlotHelpers::makeExportSettings();
@@ -49,11 +49,12 @@ protected:
 
 private slots:
     void copyGraphData2D();
+    void toggleAdaptive();
 
 private:
     QCPColorMap *_graph;
     QCPGraph *_autolimiter;
-    QAction *_actnStabilityAutolimits, *_actnCopyGraphData;
+    QAction *_actnStabilityAutolimits, *_actnCopyGraphData, *_actnAdaptive;
     QCPColorScale *_colorScale;
     bool _zAutolimitsRequest = true;
 
@@ -3,8 +3,10 @@
 #include "FuncOptionsPanel.h"
 #include "../CustomPrefs.h"
 #include "../core/Format.h"
+#include "../core/Schema.h"
 #include "../io/CommonUtils.h"
 #include "../io/JsonUtils.h"
+#include "../io/SchemaReaderJson.h"
 #include "../widgets/ElemSelectorWidget.h"
 #include "../widgets/VariableRangeEditor.h"
 
@@ -147,6 +149,15 @@ StabilityMapWindow::StabilityMapWindow(Schema *schema) :
     _actnStabBoundMarkers->setChecked(true);
     connect(_actnStabBoundMarkers, &QAction::toggled, this, &StabilityMapWindow::toggleStabBoundMarkers);
 
+    _actnAdaptive = new QAction(tr("Adaptive Points", "Plot action"), this);
+    _actnAdaptive->setToolTip(tr("Add points where the graph changes rapidly, "
+                                 "e.g. near stability boundaries"));
+    _actnAdaptive->setCheckable(true);
+    connect(_actnAdaptive, &QAction::triggered, this, &StabilityMapWindow::toggleAdaptive);
+
+    menuPlot->addSeparator();
+    menuPlot->addAction(_actnAdaptive);
+
     menuLimits->addSeparator();
     menuLimits->addAction(_actnStabilityAutolimits);
 
@@ -183,17 +194,15 @@ QWidget* StabilityMapWindow::makeOptionsPanel()
 
 QString StabilityMapWindow::readFunction(const QJsonObject& root)
 {
-    function()->setStabilityCalcMode(Z::IO::Utils::enumFromStr(
-        root["stab_calc_mode"].toString(), Z::Enums::StabilityCalcMode::Normal));
-    auto res = Z::IO::Json::readVariable(root["arg"].toObject(), function()->arg(), schema());
-    if (!res.isEmpty())
-        return res;
-    return QString();
+    auto res = Z::IO::Json::readFunction(root, function(), schema());
+    _actnAdaptive->setChecked(function()->adaptive());
+    return res;
 }
 
 QString StabilityMapWindow::writeFunction(QJsonObject& root)
 {
     root["stab_calc_mode"] = Z::IO::Utils::enumToStr(function()->stabilityCalcMode());
+    root["adaptive"] = function()->adaptive();
     root["arg"] = Z::IO::Json::writeVariable(function()->arg(), schema());
     return QString();
 }
@@ -241,6 +250,13 @@ void StabilityMapWindow::fillViewMenuActions(QList<QAction*>& actions) const
     actions << _actnStabBoundMarkers;
 }
 
+void StabilityMapWindow::toggleAdaptive()
+{
+    function()->setAdaptive(_actnAdaptive->isChecked());
+    schema()->markModified("StabilityMapWindow::toggleAdaptive");
+    update();
+}
+
 void StabilityMapWindow::toggleStabBoundMarkers(bool on)
 {
     _stabBoundMarkerLow->setVisible(on);
@@ -37,11 +37,12 @@ protected:
     QString writeWindowSpecific(QJsonObject& root) override;
 
 private:
-    QAction *_actnStabilityAutolimits, *_actnStabBoundMarkers;
+    QAction *_actnStabilityAutolimits, *_actnStabBoundMarkers, *_actnAdaptive;
     QCPItemStraightLine *_stabBoundMarkerLow, *_stabBoundMarkerTop;
 
     void updateStabBoundMarkers();
     void toggleStabBoundMarkers(bool on);
+    void toggleAdaptive();
 
     QCPItemStraightLine* makeStabBoundMarker() const;
 
@@ -73,6 +73,7 @@ public:
 
     // Implementation of SchemaListener
     void recalcRequired(Schema*) override { update(); }
+    bool recalcAffectedBy(Schema*, const SchemaChanges& changes) override { return _function->isAffectedBy(changes); }
 
     // Implementation of IEditableWindow
     SupportedCommands supportedCommands() override { return EditCmd_Copy | EditCmd_SelectAll; }
@@ -103,7 +103,16 @@ QJsonObject writeVariable(const Variable *var, Schema *schema)
 
 QString readVariable(const QJsonObject& json, Variable* var, Schema *schema)
 {
-    int elemIndex = json["element_index"].toInt(-1);
+    // Element can be referenced by label when the variable is given by user (e.g. in command line)
+    int elemIndex;
+    if (json.contains("element_label"))
+    {
+        auto elemLabel = json["element_label"].toString();
+        elemIndex = schema->indexOf(schema->elementByLabel(elemLabel));
+        if (elemIndex < 0)
+            return QString("There is no element with label '%1'").arg(elemLabel);
+    }
+    else elemIndex = json["element_index"].toInt(-1);
     Element* elem = schema->element(elemIndex);
     if (!elem)
         return QString("There is no element with index %1").arg(elemIndex);
@@ -6,6 +6,12 @@
 #include "../core/Schema.h"
 #include "../core/ElementsCatalog.h"
 #include "../core/ElementFormula.h"
+#include "../funcs/BeamVariationFunction.h"
+#include "../funcs/CausticFunction.h"
+#include "../funcs/MultibeamCausticFunction.h"
+#include "../funcs/MultirangeCausticFunction.h"
+#include "../funcs/StabilityMapFunction.h"
+#include "../funcs/StabilityMap2DFunction.h"
 #include "../AppSettings.h"
 #include "../WindowsManager.h"
 
@@ -75,13 +81,18 @@ void SchemaReaderJson::readFromUtf8(const QByteArray& data)
             "File version %1 is not supported, max supported version: %2")
                 .arg(version.str(), Z::IO::Utils::currentVersion().str()));
 
-    readGeneral(root);
-    readCustomParams(root);
-    readPumps(root);
-    readElements(root);
-    readParamLinks(root);
-    readFormulas(root);
-    readMemos(root);
+    {
+        // Matrices are calculated and driven params are evaluated once, when everything is read
+        SchemaTransaction transaction(_schema);
+
+        readGeneral(root);
+        readCustomParams(root);
+        readPumps(root);
+        readElements(root);
+        readParamLinks(root);
+        readFormulas(root);
+        readMemos(root);
+    }
 
     if (!AppSettings::instance().skipFuncWindowsLoading)
         readWindows(root);
@@ -469,6 +480,89 @@ PumpParams* readPump(const QJsonObject& root, Z::Report* report)
     return pump;
 }
 
+QString readFunctionArgs(const QJsonObject& root, MultirangeCausticFunction* func, Schema* schema)
+{
+    QVector<Z::Variable> args;
+    QJsonArray argsJson = root["args"].toArray();
+    for (auto it = argsJson.begin(); it != argsJson.end(); it++)
+    {
+        Z::Variable arg;
+        auto res = readVariable((*it).toObject(), &arg, schema);
+        if (!res.isEmpty())
+            return res;
+        args.append(arg);
+    }
+    func->setArgs(args);
+    return QString();
+}
+
+QString readFunction(const QJsonObject& root, PlotFunction* func, Schema* schema)
+{
+    // 2D stability map has its own adaptive mode hiding the one of PlotFunction
+    auto stabMap2D = dynamic_cast<StabilityMap2DFunction*>(func);
+    if (stabMap2D)
+    {
+        stabMap2D->setStabilityCalcMode(Z::IO::Utils::enumFromStr(
+            root["stab_calc_mode"].toString(), Z::Enums::StabilityCalcMode::Normal));
+        stabMap2D->setAdaptive(root["adaptive"].toBool(false));
+        auto res = readVariable(root["arg_x"].toObject(), stabMap2D->paramX(), schema);
+        if (!res.isEmpty()) return res;
+        return readVariable(root["arg_y"].toObject(), stabMap2D->paramY(), schema);
+    }
+
+    auto stabMap = dynamic_cast<StabilityMapFunction*>(func);
+    if (stabMap)
+    {
+        stabMap->setStabilityCalcMode(Z::IO::Utils::enumFromStr(
+            root["stab_calc_mode"].toString(), Z::Enums::StabilityCalcMode::Normal));
+        stabMap->setAdaptive(root["adaptive"].toBool(false));
+        return readVariable(root["arg"].toObject(), stabMap->arg(), schema);
+    }
+
+    auto caustic = dynamic_cast<CausticFunction*>(func);
+    if (caustic)
+    {
+        caustic->setMode(Z::IO::Utils::enumFromStr(root["mode"].toString(), CausticFunction::BeamRadius));
+        caustic->setAdaptive(root["adaptive"].toBool(false));
+        return readVariable(root["arg"].toObject(), caustic->arg(), schema);
+    }
+
+    // Multibeam caustic is always calculated for beam radius
+    auto multibeamCaustic = dynamic_cast<MultibeamCausticFunction*>(func);
+    if (multibeamCaustic)
+        return readFunctionArgs(root, multibeamCaustic, schema);
+
+    auto multirangeCaustic = dynamic_cast<MultirangeCausticFunction*>(func);
+    if (multirangeCaustic)
+    {
+        auto res = readFunctionArgs(root, multirangeCaustic, schema);
+        if (!res.isEmpty()) return res;
+        multirangeCaustic->setMode(Z::IO::Utils::enumFromStr(root["mode"].toString(), CausticFunction::BeamRadius));
+        return QString();
+    }
+
+    auto beamVariation = dynamic_cast<BeamVariationFunction*>(func);
+    if (beamVariation)
+    {
+        auto res = readVariable(root["arg"].toObject(), beamVariation->arg(), schema);
+        if (!res.isEmpty()) return res;
+
+        auto pos = root["pos"].toObject();
+
+        auto elem = readElemByIndex(pos, "element_index", schema);
+        if (!elem.ok()) return elem.error();
+
+        auto offset = readValue(pos["offset"].toObject());
+        if (!offset.ok()) return offset.error();
+
+        beamVariation->pos()->element = elem.value();
+        beamVariation->pos()->offset = offset.value();
+        return QString();
+    }
+
+    return QString();
+}
+
 } // namespace Json
 } // namespace IO
 } // namespace Z
@@ -8,6 +8,7 @@ class QJsonObject;
 QT_END_NAMESPACE
 
 class Element;
+class PlotFunction;
 class Schema;
 class PumpParams;
 
@@ -51,6 +52,10 @@ Element* readElement(const QJsonObject& root, Z::Report* report);
 QList<PumpParams*> readPumps(const QJsonObject& root, Z::Report* report);
 PumpParams* readPump(const QJsonObject& root, Z::Report* report);
 
+/// Reads arguments and options of a plotting function as they are stored by its window.
+/// Returns an error message or empty string. Unknown function types have nothing to read.
+QString readFunction(const QJsonObject& root, PlotFunction* func, Schema* schema);
+
 } // namespace Json
 } // namespace IO
 } // namespace Z
@@ -1,3 +1,4 @@
+#include "BatchCalc.h"
 #include "CommonData.h"
 #include "CalculatorWindow.h"
 #include "CustomElemsWindow.h"
@@ -25,6 +26,16 @@
 
 int main(int argc, char* argv[])
 {
+    // Batch calculation doesn't need widgets, so it goes before the GUI application is created
+    if (BatchCalc::isRequested(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        app.setApplicationName("reZonator");
+        app.setOrganizationName("orion-project.org");
+        app.setApplicationVersion(Z::Strs::appVersion());
+        return BatchCalc::run(app.arguments());
+    }
+
     QApplication app(argc, argv);
     app.setApplicationName("reZonator");
     app.setOrganizationName("orion-project.org");
@@ -40,10 +51,11 @@ int main(int argc, char* argv[])
     auto optionVersion = parser.addVersionOption();
     QCommandLineOption optionTest("test", "Run unit-test session.");
     QCommandLineOption optionTool("tool", "Run a tool: gauss, calc", "name");
+    QCommandLineOption optionCalc("calc", "Calculate functions of schema file without GUI, see --calc --help.");
     QCommandLineOption optionDevMode("dev"); optionDevMode.setFlags(QCommandLineOption::HiddenFromHelp);
     QCommandLineOption optionConsole("console"); optionConsole.setFlags(QCommandLineOption::HiddenFromHelp);
     QCommandLineOption optionExample("example"); optionExample.setFlags(QCommandLineOption::HiddenFromHelp);
-    parser.addOptions({optionTest, optionTool, optionDevMode, optionConsole, optionExample});
+    parser.addOptions({optionTest, optionTool, optionCalc, optionDevMode, optionConsole, optionExample});
 
     if (!parser.parse(QApplication::arguments()))
     {
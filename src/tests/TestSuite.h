@@ -24,14 +24,19 @@ USE_GROUP(SchemaReaderJsonTests)                   // test_SchemaReaderJson.cpp
 USE_GROUP(RoundTripCalculatorTests)                // test_RoundTripCalculator.cpp
 USE_GROUP(GaussCalculatorTests)                    // test_GaussCalculator.cpp
 USE_GROUP(GrinCalculatorTests)                     // test_GrinCalculator.cpp
+USE_GROUP(RootFinderTests)                         // test_RootFinder.cpp
+USE_GROUP(ResultCacheTests)                        // test_ResultCache.cpp
 USE_GROUP(PumpCalculatorTests)                     // test_PumpCalculator.cpp
 USE_GROUP(AbcdBeamCalculatorTests)                 // test_AbcdBeamCalculator.cpp
+USE_GROUP(FunctionUtilsTests)                      // test_FunctionUtils.cpp
 USE_GROUP(InfoFunctionsTests)                      // test_InfoFunctions.cpp
 USE_GROUP(PlotFunctionsTests)                      // test_PlotFunctions.cpp
 USE_GROUP(TableFunctionTests)                      // test_TableFunction.cpp
+USE_GROUP(BatchCalcTests)                          // test_BatchCalc.cpp
 USE_GROUP(ElementSelectorWidgetTests)              // test_ElemSelectorWidget.cpp
 USE_GROUP(PumpWindowTests)                         // test_PumpWindow.cpp
 USE_GROUP(LuaHelperTests)                          // test_LuaHelper.cpp
+USE_GROUP(ExpressionTests)                         // test_Expression.cpp
 USE_GROUP(ProjectOperationsTests)                  // test_ProjectOperations.cpp
 
 TEST_SUITE(
@@ -56,14 +61,19 @@ TEST_SUITE(
     ADD_GROUP(RoundTripCalculatorTests),
     ADD_GROUP(GaussCalculatorTests),
     ADD_GROUP(GrinCalculatorTests),
+    ADD_GROUP(RootFinderTests),
+    ADD_GROUP(ResultCacheTests),
     ADD_GROUP(PumpCalculatorTests),
     ADD_GROUP(AbcdBeamCalculatorTests),
+    ADD_GROUP(FunctionUtilsTests),
     ADD_GROUP(InfoFunctionsTests),
     ADD_GROUP(PlotFunctionsTests),
     ADD_GROUP(TableFunctionTests),
+    ADD_GROUP(BatchCalcTests),
     ADD_GROUP(ElementSelectorWidgetTests),
     ADD_GROUP(PumpWindowTests),
     ADD_GROUP(LuaHelperTests),
+    ADD_GROUP(ExpressionTests),
     ADD_GROUP(ProjectOperationsTests),
 )
 
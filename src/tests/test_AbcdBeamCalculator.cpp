@@ -88,6 +88,39 @@ TEST_METHOD(real_calc_ts)
     ASSERT_NEAR_TS(calc.halfAngle(mt, ms, 1), (0.129402667_deg).toSi(), (0.0425118626_deg).toSi(), 1e-10)
 }
 
+TEST_METHOD(calc_batch)
+{
+    CALCULATOR
+    QVector<Z::Matrix> matrices {
+        // stable
+        { 1.22740581, 0.933155617, -5.17573851, -3.12021454 },
+        { 1.07321435, 0.805228946, -1.57668319, -0.251199535 },
+        // stable with negative B
+        { 1.2, -0.9, 5.1, -3.1 },
+        // unstable
+        { -0.577181785, -0.511906815, 24.6309496, 20.1128159 },
+    };
+    Z::MatrixBatch batch;
+    for (const Z::Matrix& m : matrices)
+        batch.append(m);
+    ASSERT_IS_TRUE(batch.isReal())
+
+    for (double ior : { 1.0, 1.5 })
+    {
+        QVector<double> w(batch.size()), r(batch.size()), v(batch.size());
+        calc.beamRadius(batch, ior, w.data());
+        calc.frontRadius(batch, ior, r.data());
+        calc.halfAngle(batch, ior, v.data());
+        for (int i = 0; i < batch.size(); i++)
+        {
+            TEST_LOG(matrices.at(i).str())
+            ASSERT_NEAR_TS(Z::PointTS(w.at(i), v.at(i)),
+                calc.beamRadius(matrices.at(i), ior), calc.halfAngle(matrices.at(i), ior), 1e-15)
+            ASSERT_NEAR_DBL(r.at(i), calc.frontRadius(matrices.at(i), ior), 1e-12)
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 
 TEST_GROUP("AbcdBeamCalculator",
@@ -98,6 +131,7 @@ TEST_GROUP("AbcdBeamCalculator",
            ADD_TEST(real_halfAngle__must_return_nan_when_unstable),
            ADD_TEST(real_halfAngle),
            ADD_TEST(real_calc_ts),
+           ADD_TEST(calc_batch),
            // TODO: add tests for calculation inside a medium
            )
 
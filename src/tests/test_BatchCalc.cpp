@@ -0,0 +1,133 @@
+#include "testing/OriTestBase.h"
+#include "TestUtils.h"
+#include "../AppSettings.h"
+#include "../BatchCalc.h"
+#include "../core/Schema.h"
+#include "../funcs/CausticFunction.h"
+#include "../io/SchemaReaderJson.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#include <memory>
+
+namespace Z {
+namespace Tests {
+namespace BatchCalcTests {
+
+#define READ_TEST_FILE(file_name)\
+    Schema schema;\
+    bool oldSkip = AppSettings::instance().skipFuncWindowsLoading;\
+    AppSettings::instance().skipFuncWindowsLoading = true;\
+    TEST_FILE(fullFileName, file_name)\
+    QFile file(fullFileName);\
+    ASSERT_IS_TRUE(file.open(QIODevice::ReadOnly | QIODevice::Text))\
+    auto data = file.readAll();\
+    SchemaReaderJson reader(&schema);\
+    reader.readFromUtf8(data);\
+    AppSettings::instance().skipFuncWindowsLoading = oldSkip;\
+    LOG_SCHEMA_READER(reader)\
+    ASSERT_IS_FALSE(reader.report().hasErrors())\
+    QString output;\
+    QTextStream out(&output);\
+    BatchCalc calc(&schema, &out);
+
+static int countLines(const QString& output, const QString& prefix)
+{
+    int count = 0;
+    for (const QString& line : output.split('\n'))
+        if (line.startsWith(prefix))
+            count++;
+    return count;
+}
+
+//------------------------------------------------------------------------------
+
+TEST_METHOD(makeFunction)
+{
+    Schema schema;
+    for (auto alias : { "StabMap", "StabMap2D", "Caustic", "MultirangeCaustic", "Multicaustic",
+                        "MultibeamCaustic", "BeamVariation" })
+    {
+        TEST_LOG(alias)
+        std::unique_ptr<PlotFunction> func(BatchCalc::makeFunction(alias, &schema));
+        ASSERT_IS_NOT_NULL(func.get())
+    }
+    ASSERT_IS_NULL(BatchCalc::makeFunction("Unknown", &schema))
+}
+
+TEST_METHOD(calcStoredFunctions)
+{
+    READ_TEST_FILE("test_plot_funcs.rez")
+
+    calc.calcStoredFunctions(QJsonDocument::fromJson(data).object());
+    out.flush();
+    TEST_LOG(calc.report().str())
+    ASSERT_IS_FALSE(calc.report().hasErrors())
+    ASSERT_IS_TRUE(output.startsWith("# Stability Map (window #0)\n"))
+    ASSERT_IS_TRUE(countLines(output, "T\t") > 0)
+    ASSERT_IS_TRUE(countLines(output, "S\t") > 0)
+}
+
+TEST_METHOD(calcFunction)
+{
+    READ_TEST_FILE("test_plot_funcs.rez")
+
+    auto args = QJsonDocument::fromJson(R"({
+        "mode": "BeamRadius",
+        "arg": {
+            "element_label": "L",
+            "param": "L",
+            "range": {
+                "start": { "value": 0, "unit": "mm" },
+                "stop": { "value": 50, "unit": "mm" },
+                "step": { "value": 0, "unit": "mm" },
+                "points": 10
+            }
+        }
+    })").object();
+    calc.calcFunction("Caustic", args, "Test caustic");
+    out.flush();
+    TEST_LOG(output)
+    ASSERT_IS_TRUE(calc.report().isEmpty())
+    ASSERT_IS_TRUE(output.startsWith("# Test caustic\nplane\tsegment\tx\ty\n"))
+
+    // The same points as the function calculates itself
+    CausticFunction func(&schema);
+    ASSERT_EQ_STR(Z::IO::Json::readFunction(args, &func, &schema), "")
+    ASSERT_EQ_PTR(func.arg()->element, schema.elementByLabel("L"))
+    func.calculate();
+    ASSERT_IS_TRUE(func.ok())
+    ASSERT_EQ_INT(countLines(output, "T\t"), func.result(Z::Plane_T, 0).pointsCount())
+    ASSERT_EQ_INT(countLines(output, "S\t"), func.result(Z::Plane_S, 0).pointsCount())
+}
+
+TEST_METHOD(calcFunction_errors)
+{
+    READ_TEST_FILE("test_plot_funcs.rez")
+
+    calc.calcFunction("Unknown", QJsonObject());
+    ASSERT_IS_TRUE(calc.report().hasErrors())
+
+    BatchCalc calc1(&schema, &out);
+    calc1.calcFunction("Caustic", QJsonObject({{"arg", QJsonObject({{"element_label", "X"}})}}));
+    TEST_LOG(calc1.report().str())
+    ASSERT_IS_TRUE(calc1.report().hasErrors())
+
+    out.flush();
+    ASSERT_IS_TRUE(output.isEmpty())
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("BatchCalc",
+    ADD_TEST(makeFunction),
+    ADD_TEST(calcStoredFunctions),
+    ADD_TEST(calcFunction),
+    ADD_TEST(calcFunction_errors),
+)
+
+} // namespace BatchCalcTests
+} // namespace Tests
+} // namespace Z
@@ -137,6 +137,35 @@ TEST_METHOD(params_in_formula_must_be_in_si_units)
     ASSERT_MATRIX(t, 0.1, 0.1, 0.1, 0.1)
 }
 
+TEST_METHOD(can_recalculate_compiled_formula)
+{
+    ElemFormula elem;
+    elem.setHasMatricesTS(false);
+    ADD_PARAM(a, 1)
+    ADD_PARAM(b, 2)
+    CALC_TEST_MATRIX("A=a; B=b; C=a+b; D=a*b")
+    ASSERT_MATRIX(t, 1, 2, 3, 2)
+
+    p_a->setValue(3);
+    elem.calcMatrix("test");
+    ASSERT_MATRIX(t, 3, 2, 5, 6)
+
+    elem.moveParamUp(p_b);
+    p_b->setValue(4);
+    elem.calcMatrix("test");
+    ASSERT_MATRIX(t, 3, 4, 7, 12)
+
+    CALC_TEST_MATRIX("A=b; B=a; C=a-b; D=1")
+    ASSERT_MATRIX(t, 4, 3, -1, 1)
+
+    CALC_TEST_MATRIX("A=b; B=a; C=")
+    ASSERT_ERROR("")
+    ASSERT_MATRIX_IS_UNITY(elem.Mt())
+
+    CALC_TEST_MATRIX("A=b; B=a; C=a-b; D=1")
+    ASSERT_MATRIX(t, 4, 3, -1, 1)
+}
+
 TEST_METHOD(reset_must_clear_vars)
 {
     ElemFormula elem;
@@ -279,6 +308,7 @@ TEST_GROUP("ElementFormula",
            ADD_TEST(matrix_must_be_unity_when_no_cs),
            ADD_TEST(matrix_must_be_unity_when_no_ds),
            ADD_TEST(params_in_formula_must_be_in_si_units),
+           ADD_TEST(can_recalculate_compiled_formula),
            ADD_TEST(reset_must_clear_vars),
            ADD_TEST(addParam__must_do_nothing_if_param_already_added),
            ADD_TEST(removeParam__must_destruct),
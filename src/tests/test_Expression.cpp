@@ -0,0 +1,121 @@
+#include "testing/OriTestBase.h"
+#include "../core/Expression.h"
+#include "../core/LuaHelper.h"
+
+#include <QtMath>
+
+namespace Z {
+namespace Tests {
+namespace ExpressionTests {
+
+#define ASSERT_EXPR(code, vars, expected_value) {\
+    Z::Expression expr;\
+    ASSERT_IS_TRUE(expr.compile(code, {"a", "b"}))\
+    ASSERT_EQ_DBL(expr.calculate(vars), expected_value)\
+}
+
+#define ASSERT_NOT_EXPR(code) {\
+    Z::Expression expr;\
+    TEST_LOG(code)\
+    ASSERT_IS_FALSE(expr.compile(code, {"a", "b"}))\
+    ASSERT_IS_FALSE(expr.ok())\
+}
+
+TEST_METHOD(calculate)
+{
+    QVector<double> vars {2, 3};
+
+    ASSERT_EXPR("42", vars, 42)
+    ASSERT_EXPR("1.5e2 + .5", vars, 150.5)
+    ASSERT_EXPR("a + b", vars, 5)
+    ASSERT_EXPR("a - b - 1", vars, -2)
+    ASSERT_EXPR("a + 2*b", vars, 8)
+    ASSERT_EXPR("(a + 2)*b", vars, 12)
+    ASSERT_EXPR("b / a / 2", vars, 0.75)
+    ASSERT_EXPR("a ^ b ^ 2", vars, 512)
+    ASSERT_EXPR("-a ^ 2", vars, -4)
+    ASSERT_EXPR("a ^ -1", vars, 0.5)
+    ASSERT_EXPR("- -a * b", vars, 6)
+    ASSERT_EXPR("sqrt(a * 8)", vars, 4)
+    ASSERT_EXPR("abs(a - b) + pi()", vars, 1 + M_PI)
+    ASSERT_EXPR("ans = a * b", vars, 6)
+    ASSERT_EXPR(" ans=a\n + b", vars, 5)
+}
+
+TEST_METHOD(calculate_same_as_lua)
+{
+    Z::Lua lua;
+    ASSERT_EQ_STR(lua.open(), "")
+    lua.setGlobalVar("a", 0.33);
+
+    const QStringList funcs { "sin", "sinh", "asin", "cos", "cosh", "acos", "tan", "tanh", "atan",
+        "cot", "coth", "acot", "sec", "sech", "csc", "csch", "abs", "floor", "ceil",
+        "exp", "ln", "lg", "sqrt", "deg2rad", "rad2deg" };
+    const QStringList codes { "%1(a)", "%1(-a^2 + 1)", "2*%1(a)/(1 - a)" };
+    for (const QString& func : funcs)
+    {
+        ASSERT_IS_TRUE(Z::Expression::isFunction(func))
+        for (const QString& c : codes)
+        {
+            auto code = c.arg(func);
+            TEST_LOG(code)
+            Z::Expression expr;
+            ASSERT_IS_TRUE(expr.compile(code, {"a"}))
+            auto res = lua.calculate(code);
+            ASSERT_IS_TRUE(res.ok())
+            ASSERT_EQ_DBL(expr.calculate({0.33}), res.value())
+        }
+    }
+    ASSERT_IS_TRUE(Z::Expression::isFunction("pi"))
+    ASSERT_IS_FALSE(Z::Expression::isFunction("unknown"))
+}
+
+TEST_METHOD(must_not_compile_unsupported_code)
+{
+    ASSERT_NOT_EXPR("")
+    ASSERT_NOT_EXPR("a +")
+    ASSERT_NOT_EXPR("(a + b")
+    ASSERT_NOT_EXPR("a + c")
+    ASSERT_NOT_EXPR("+a")
+    ASSERT_NOT_EXPR("a --b")
+    ASSERT_NOT_EXPR("a // b")
+    ASSERT_NOT_EXPR("a % b")
+    ASSERT_NOT_EXPR("0x10")
+    ASSERT_NOT_EXPR("2a")
+    ASSERT_NOT_EXPR("1e")
+    ASSERT_NOT_EXPR("a and b")
+    ASSERT_NOT_EXPR("a < b")
+    ASSERT_NOT_EXPR("math.sin(a)")
+    ASSERT_NOT_EXPR("sin(a, b)")
+    ASSERT_NOT_EXPR("pi(a)")
+    ASSERT_NOT_EXPR("unknown(a)")
+    ASSERT_NOT_EXPR("a(b)")
+    ASSERT_NOT_EXPR("ans == a")
+    ASSERT_NOT_EXPR("c = a; ans = c")
+    ASSERT_NOT_EXPR("if a > b then ans = a else ans = b end")
+}
+
+TEST_METHOD(variables_hide_functions)
+{
+    Z::Expression expr;
+    ASSERT_IS_TRUE(expr.compile("exp * 2", {"exp"}))
+    ASSERT_EQ_DBL(expr.calculate({3}), 6)
+    ASSERT_IS_FALSE(expr.compile("exp(1)", {"exp"}))
+
+    // The last of the same named variables is visible, as it is in Lua
+    ASSERT_IS_TRUE(expr.compile("a", {"a", "a"}))
+    ASSERT_EQ_DBL(expr.calculate({1, 2}), 2)
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("Expression",
+    ADD_TEST(calculate),
+    ADD_TEST(calculate_same_as_lua),
+    ADD_TEST(must_not_compile_unsupported_code),
+    ADD_TEST(variables_hide_functions),
+)
+
+} // namespace ExpressionTests
+} // namespace Tests
+} // namespace Z
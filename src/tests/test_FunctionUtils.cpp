@@ -0,0 +1,155 @@
+#include "testing/OriTestBase.h"
+#include "TestUtils.h"
+#include "../core/Schema.h"
+#include "../core/Elements.h"
+#include "../core/Pump.h"
+#include "../funcs/FunctionUtils.h"
+#include "../funcs/PumpCalculator.h"
+#include "../funcs/RoundTripCalculator.h"
+
+#include <QElapsedTimer>
+
+namespace Z {
+namespace Tests {
+namespace FunctionUtilsTests {
+
+using PumpCalcs = Z::PairTS<std::shared_ptr<PumpCalculator>>;
+
+static ElemEmptyRange* makeSpace(double lengthMm)
+{
+    auto elem = new ElemEmptyRange;
+    elem->paramLength()->setValue(Z::Value(lengthMm, Z::Units::mm()));
+    return elem;
+}
+
+static ElemThinLens* makeLens(double focusMm)
+{
+    auto elem = new ElemThinLens;
+    elem->params().byAlias("F")->setValue(Z::Value(focusMm, Z::Units::mm()));
+    return elem;
+}
+
+static ElemAxiconMirror* makeAxicon(double thetaDeg)
+{
+    auto elem = new ElemAxiconMirror;
+    elem->params().byAlias("Theta")->setValue(Z::Value(thetaDeg, Z::Units::deg()));
+    return elem;
+}
+
+static void addPump(Schema* schema)
+{
+    auto pump = new PumpParams_Waist;
+    pump->waist()->setValue(Z::ValueTS(110, 90, Z::Units::mkm()));
+    pump->distance()->setValue(Z::ValueTS(100, 100, Z::Units::mm()));
+    pump->MI()->setValue(Z::ValueTS(1, 1, Z::Units::none()));
+    pump->activate(true);
+    schema->pumps()->append(pump);
+}
+
+// Expected dynamic matrix is calculated from a separate round-trip to the previous element,
+// it is how the matrix is defined, see ElementDynamic::CalcParams
+#define ASSERT_AXICON_MATRIX(index) {\
+    auto axicon = dynamic_cast<ElemAxiconMirror*>(schema.element(index));\
+    ASSERT_IS_NOT_NULL(axicon)\
+    RoundTripCalculator calc(&schema, schema.element(index - 1));\
+    calc.calcRoundTrip();\
+    calc.multMatrix();\
+    auto wt = pumpCalc.T->calc(calc.Mt(), 1).beamRadius;\
+    auto ws = pumpCalc.S->calc(calc.Ms(), 1).beamRadius;\
+    auto ct = -2 * axicon->theta() / qAbs(wt);\
+    auto cs = -2 * axicon->theta() / qAbs(ws);\
+    TEST_LOG(QString("%1: Ct=%2 Cs=%3").arg(axicon->displayLabel()).arg(ct).arg(cs))\
+    ASSERT_NEAR_DBL(axicon->Mt_dyn().C.real(), ct, qAbs(ct) * 1e-9)\
+    ASSERT_NEAR_DBL(axicon->Ms_dyn().C.real(), cs, qAbs(cs) * 1e-9)\
+}
+
+//------------------------------------------------------------------------------
+
+TEST_METHOD(prepareDynamicElements__multiple_elements)
+{
+    Schema schema;
+    schema.setTripType(TripType::SP);
+    schema.wavelength().setValue(1000_nm);
+    schema.insertElements({
+        makeSpace(50), makeAxicon(1), makeSpace(100), makeLens(80),
+        makeSpace(70), makeAxicon(2), makeSpace(30), makeAxicon(0.5), makeSpace(200)
+    }, -1, Arg::RaiseEvents(false));
+    addPump(&schema);
+
+    PumpCalcs pumpCalc;
+    ASSERT_EQ_STR(FunctionUtils::preparePumpCalculator(&schema, nullptr, pumpCalc), "")
+    FunctionUtils::prepareDynamicElements(&schema, nullptr, pumpCalc);
+
+    // Each axicon sees the beam changed by all the previous ones, not only by the first element
+    ASSERT_AXICON_MATRIX(1)
+    ASSERT_AXICON_MATRIX(5)
+    ASSERT_AXICON_MATRIX(7)
+}
+
+TEST_METHOD(prepareDynamicElements__stop_elem)
+{
+    Schema schema;
+    schema.setTripType(TripType::SP);
+    schema.wavelength().setValue(1000_nm);
+    auto stopElem = makeSpace(30);
+    schema.insertElements({
+        makeSpace(50), makeAxicon(1), makeSpace(100), makeAxicon(2), stopElem, makeAxicon(0.5)
+    }, -1, Arg::RaiseEvents(false));
+    addPump(&schema);
+
+    PumpCalcs pumpCalc;
+    ASSERT_EQ_STR(FunctionUtils::preparePumpCalculator(&schema, nullptr, pumpCalc), "")
+    FunctionUtils::prepareDynamicElements(&schema, stopElem, pumpCalc);
+
+    ASSERT_AXICON_MATRIX(1)
+    ASSERT_AXICON_MATRIX(3)
+
+    // Elements after the stop one are not calculated
+    auto lastAxicon = dynamic_cast<ElemAxiconMirror*>(schema.element(5));
+    ASSERT_MATRIX_IS(lastAxicon->Mt_dyn(), 1, 0, 0, 1)
+    ASSERT_MATRIX_IS(lastAxicon->Ms_dyn(), 1, 0, 0, 1)
+}
+
+TEST_METHOD(prepareDynamicElements__long_schema)
+{
+    Schema schema;
+    schema.setTripType(TripType::SP);
+    schema.wavelength().setValue(1000_nm);
+    Elements elems;
+    for (int i = 0; i < 500; i++)
+    {
+        if (i % 50 == 49)
+            elems << makeAxicon(0.1);
+        else if (i % 2)
+            elems << makeLens(1000);
+        else
+            elems << makeSpace(10);
+    }
+    schema.insertElements(elems, -1, Arg::RaiseEvents(false));
+    addPump(&schema);
+
+    PumpCalcs pumpCalc;
+    ASSERT_EQ_STR(FunctionUtils::preparePumpCalculator(&schema, nullptr, pumpCalc), "")
+
+    QElapsedTimer timer;
+    timer.start();
+    const int repeats = 100;
+    for (int i = 0; i < repeats; i++)
+        FunctionUtils::prepareDynamicElements(&schema, nullptr, pumpCalc);
+    TEST_LOG(QString("%1 elements, %2 runs: %3 ms").arg(schema.count()).arg(repeats).arg(timer.elapsed()))
+
+    ASSERT_AXICON_MATRIX(49)
+    ASSERT_AXICON_MATRIX(499)
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("FunctionUtils",
+    ADD_TEST(prepareDynamicElements__multiple_elements),
+    ADD_TEST(prepareDynamicElements__stop_elem),
+    ADD_TEST(prepareDynamicElements__long_schema),
+)
+
+} // namespace FunctionUtilsTests
+} // namespace Tests
+} // namespace Z
@@ -209,6 +209,42 @@ TEST_METHOD(can_show_refined_error_messages)
     ASSERT_LUA_ERROR(lua, "sin(a)", "Invalid argument for 'sin': unknown variable")
 }
 
+TEST_METHOD(can_call_compiled_code)
+{
+    OPEN_LUA(lua)
+
+    ASSERT_EQ_STR(lua.compile("a + b", {"a", "b"}), "")
+    auto res = lua.call({1, 2});
+    ASSERT_IS_TRUE(res.ok())
+    ASSERT_EQ_DBL(res.value(), 3)
+    res = lua.call({3, 4});
+    ASSERT_IS_TRUE(res.ok())
+    ASSERT_EQ_DBL(res.value(), 7)
+
+    ASSERT_EQ_STR(lua.compile("c = a * 2\nans = c + 1", {"a"}), "")
+    res = lua.call({5});
+    ASSERT_IS_TRUE(res.ok())
+    ASSERT_EQ_DBL(res.value(), 11)
+
+    ASSERT_EQ_STR(lua.compile("if a > 0 then ans = 1 end", {"a"}), "")
+    res = lua.call({1});
+    ASSERT_IS_TRUE(res.ok())
+    ASSERT_EQ_DBL(res.value(), 1)
+    // the result of previous call must not be taken
+    res = lua.call({-1});
+    ASSERT_IS_FALSE(res.ok())
+    TEST_LOG(res.error())
+
+    ASSERT_EQ_STR(lua.compile("a + b", {"a"}), "")
+    res = lua.call({1});
+    ASSERT_IS_FALSE(res.ok())
+    ASSERT_EQ_STR(res.error(), "Unknown variable 'b'")
+
+    auto error = lua.compile("a +", {"a"});
+    TEST_LOG(error)
+    ASSERT_IS_FALSE(error.isEmpty())
+}
+
 //------------------------------------------------------------------------------
 
 TEST_GROUP("LuaHelper",
@@ -224,6 +260,7 @@ TEST_GROUP("LuaHelper",
     ADD_TEST(can_calc_several_values),
     ADD_TEST(can_remove_global),
     ADD_TEST(can_show_refined_error_messages),
+    ADD_TEST(can_call_compiled_code),
 )
 
 } // namespace LuaHelperTests
@@ -72,6 +72,62 @@ TEST_METHOD(Matrix_multComplexBeam)
     ASSERT_NEAR_DBL(c2.imag(), -0.0095012, 1e-7)
 }
 
+TEST_METHOD(RealMatrix_multiply)
+{
+    Z::RealMatrix m1(5, 6, 7, 8);
+
+    Z::RealMatrix m2(1, 2, 3, 4);
+    m2 *= m1;
+    ASSERT_MATRIX_IS(m2.toMatrix(), 19.0, 22.0, 43.0, 50.0)
+
+    // by complex matrix pointer, only real parts are used
+    Z::Matrix m3(Z::Complex(5, 1), Z::Complex(6, 1), Z::Complex(7, 1), Z::Complex(8, 1));
+    Z::RealMatrix m4(1, 2, 3, 4);
+    m4 *= &m3;
+    ASSERT_MATRIX_IS(m4.toMatrix(), 19.0, 22.0, 43.0, 50.0)
+}
+
+TEST_METHOD(MatrixProductTree_update)
+{
+    Z::Matrix m1(1, 2, 3, 4), m2(5, 6, 7, 8), m3(1, 1, 0, 1);
+    Z::MatrixProductTree tree;
+
+    tree.build({});
+    ASSERT_MATRIX_IS_UNITY(tree.product())
+
+    tree.build({&m1, &m2, &m3});
+    ASSERT_EQ_INT(tree.size(), 3)
+    ASSERT_EQ_MATRIX(tree.product(), m1 * m2 * m3)
+
+    m2.assign(2, 0, 1, 2);
+    tree.update(1);
+    ASSERT_EQ_MATRIX(tree.product(), m1 * m2 * m3)
+}
+
+TEST_METHOD(MatrixBatch_append)
+{
+    Z::MatrixBatch batch;
+    batch.append(Z::Matrix(1, 2, 3, 4));
+    batch.append(Z::Matrix(5, 6, 7, 8));
+    ASSERT_EQ_INT(batch.size(), 2)
+    ASSERT_IS_TRUE(batch.isReal())
+    ASSERT_EQ_DBL(batch.A()[1], 5)
+    ASSERT_EQ_DBL(batch.D()[0], 4)
+    ASSERT_MATRIX_IS(batch.at(1), 5.0, 6.0, 7.0, 8.0)
+
+    // Previous matrices stay real when a complex one is appended
+    Z::Matrix m(Z::Complex(1, 1), 2, 3, Z::Complex(4, -1));
+    batch.append(m);
+    ASSERT_EQ_INT(batch.size(), 3)
+    ASSERT_IS_FALSE(batch.isReal())
+    ASSERT_MATRIX_IS(batch.at(0), 1.0, 2.0, 3.0, 4.0)
+    ASSERT_EQ_MATRIX(batch.at(2), m)
+
+    batch.clear();
+    ASSERT_IS_TRUE(batch.isEmpty())
+    ASSERT_IS_TRUE(batch.isReal())
+}
+
 //------------------------------------------------------------------------------
 
 #define ASSERT_VECTOR(vector, y, v)\
@@ -114,6 +170,9 @@ TEST_GROUP("Math",
     ADD_TEST(Matrix_multiply),
     ADD_TEST(Matrix_multiply_static),
     ADD_TEST(Matrix_multComplexBeam),
+    ADD_TEST(RealMatrix_multiply),
+    ADD_TEST(MatrixProductTree_update),
+    ADD_TEST(MatrixBatch_append),
     ADD_TEST(RayVector_constructors),
     ADD_TEST(RayVector_set)
 )
@@ -1,4 +1,5 @@
 #include "testing/OriTestBase.h"
+#include "../core/Formula.h"
 #include "../core/Parameters.h"
 #include "TestUtils.h"
 
@@ -120,6 +121,80 @@ TEST_GROUP("ParameterFilter",
 
 //------------------------------------------------------------------------------
 
+namespace FormulaTests {
+
+TEST_METHOD(Formula_calculate)
+{
+    Z::Parameter a(Z::Dims::linear(), "a", "", "");
+    Z::Parameter b(Z::Dims::linear(), "b", "", "");
+    Z::Parameter target(Z::Dims::linear(), "target", "", "");
+    a.setValue(1_m);
+    b.setValue(2_m);
+    target.setValue(0_m);
+
+    Z::Formula formula(&target);
+    formula.addDep(&a);
+    formula.addDep(&b);
+    formula.setCode("a + b");
+    formula.calculate();
+    ASSERT_IS_TRUE(formula.ok())
+    ASSERT_IS_TRUE(formula.isNative())
+    ASSERT_EQ_ZVALUE(target.value(), 3_m)
+
+    // formula is recalculated with the same compiled code when deps are changed
+    a.setValue(3_m);
+    ASSERT_IS_TRUE(formula.ok())
+    ASSERT_EQ_ZVALUE(target.value(), 5_m)
+
+    formula.setCode("a * b");
+    formula.calculate();
+    ASSERT_IS_TRUE(formula.ok())
+    ASSERT_EQ_ZVALUE(target.value(), 6_m)
+
+    formula.setCode("if a > b then ans = a else ans = b end");
+    formula.calculate();
+    ASSERT_IS_TRUE(formula.ok())
+    ASSERT_IS_FALSE(formula.isNative())
+    ASSERT_EQ_ZVALUE(target.value(), 3_m)
+
+    formula.removeDep(&b);
+    formula.calculate();
+    ASSERT_IS_FALSE(formula.ok())
+    ASSERT_EQ_STR(formula.status(), "Unknown variable 'b'")
+}
+
+TEST_METHOD(Formula_errors)
+{
+    Z::Parameter a(Z::Dims::linear(), "a", "", "");
+    Z::Parameter target(Z::Dims::linear(), "target", "", "");
+    a.setValue(1_m);
+    target.setValue(0_m);
+
+    Z::Formula formula(&target);
+    formula.addDep(&a);
+    formula.calculate();
+    ASSERT_IS_FALSE(formula.ok())
+
+    formula.setCode("a +");
+    formula.calculate();
+    ASSERT_IS_FALSE(formula.ok())
+    TEST_LOG(formula.status())
+
+    formula.setCode("a * 2");
+    formula.calculate();
+    ASSERT_IS_TRUE(formula.ok())
+    ASSERT_EQ_ZVALUE(target.value(), 2_m)
+}
+
+TEST_GROUP("Formula",
+    ADD_TEST(Formula_calculate),
+    ADD_TEST(Formula_errors),
+)
+
+} // namespace FormulaTests
+
+//------------------------------------------------------------------------------
+
 TEST_GROUP("Parameters",
     ADD_TEST(Parameter_ctor_default),
     ADD_TEST(Parameter_ctor_params),
@@ -129,6 +204,7 @@ TEST_GROUP("Parameters",
     ADD_TEST(Parameters_byIndex),
     ADD_TEST(Parameters_byPointer),
     ADD_GROUP(ParameterFilterTests),
+    ADD_GROUP(FormulaTests),
 )
 
 } // namespace ParametersTests
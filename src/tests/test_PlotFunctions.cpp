@@ -1,5 +1,6 @@
 #include "testing/OriTestBase.h"
 #include "TestUtils.h"
+#include "../AppSettings.h"
 #include "../core/Schema.h"
 #include "../core/Elements.h"
 #include "../funcs/StabilityMapFunction.h"
@@ -8,6 +9,12 @@
 #include "../funcs/BeamVariationFunction.h"
 #include "../funcs/MultirangeCausticFunction.h"
 #include "../funcs/MultibeamCausticFunction.h"
+#include "../funcs/EvalContext.h"
+#include "../funcs/OpticalProgram.h"
+#include "../funcs/RoundTripCalculator.h"
+#include "../funcs/AbcdBeamCalculator.h"
+#include "../funcs/FunctionUtils.h"
+#include "../funcs/PumpCalculator.h"
 
 #include <QTextStream>
 
@@ -198,10 +205,65 @@ TEST_METHOD(calculateAt)
     ASSERT_NEAR_TS(func.calculateAt(7_cm), -820.10025, -591.667213, 1e-6)
 }
 
+TEST_METHOD(calculate_adaptive)
+{
+    TEST_STAB_MAP_FUNC(Z::Enums::StabilityCalcMode::Normal)
+    auto uniformX = func.result(Z::WorkPlane::Plane_T, 0).x();
+    func.setAdaptive(true);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_FUNC_RESULT_COUNT(1)
+    for (auto plane : { Z::WorkPlane::Plane_T, Z::WorkPlane::Plane_S })
+    {
+        auto res = func.result(plane, 0);
+        TEST_LOG(QString("Points count: %1").arg(res.pointsCount()))
+        ASSERT_IS_TRUE(res.pointsCount() > uniformX.size())
+        ASSERT_IS_TRUE(res.pointsCount() <= 4 * uniformX.size())
+        for (int i = 1; i < res.pointsCount(); i++)
+            ASSERT_IS_TRUE(res.x().at(i) > res.x().at(i-1))
+        for (auto x : uniformX)
+            ASSERT_IS_TRUE(res.x().contains(x))
+        for (int i = 0; i < res.pointsCount(); i++)
+        {
+            auto p = func.calculateAt(Z::Value(res.x().at(i), Z::Units::m()));
+            ASSERT_NEAR_DBL(res.y().at(i), plane == Z::WorkPlane::Plane_T ? p.T : p.S, 1e-9)
+        }
+    }
+}
+
+// Both boundaries of each stable range are between the same pair of scan points
+TEST_CASE_METHOD(stableIntervals, Z::Enums::StabilityCalcMode mode)
+{
+    TEST_STAB_MAP_FUNC(mode)
+    auto intervals = func.stableIntervals();
+    ASSERT_EQ_INT(intervals.T.size(), 2)
+    ASSERT_NEAR_DBL(intervals.T.at(0).start, 0.0246201938253052, 1e-14)
+    ASSERT_NEAR_DBL(intervals.T.at(0).stop, 0.0261532866503034, 1e-14)
+    ASSERT_NEAR_DBL(intervals.T.at(1).start, 0.0545060347680576, 1e-14)
+    ASSERT_NEAR_DBL(intervals.T.at(1).stop, 0.0560391275930557, 1e-14)
+    ASSERT_EQ_INT(intervals.S.size(), 2)
+    ASSERT_NEAR_DBL(intervals.S.at(0).start, 0.0253856652971436, 1e-14)
+    ASSERT_NEAR_DBL(intervals.S.at(0).stop, 0.0270187331963720, 1e-14)
+    ASSERT_NEAR_DBL(intervals.S.at(1).start, 0.0555002604234440, 1e-14)
+    ASSERT_NEAR_DBL(intervals.S.at(1).stop, 0.0571333283226724, 1e-14)
+
+    double boundary = mode == Z::Enums::StabilityCalcMode::Normal ? 1 : 0;
+    for (const auto& interval : intervals.T)
+    {
+        ASSERT_NEAR_DBL(qAbs(func.calculateAt(Z::Value(interval.start, Z::Units::m())).T), boundary, 1e-9)
+        ASSERT_NEAR_DBL(qAbs(func.calculateAt(Z::Value(interval.stop, Z::Units::m())).T), boundary, 1e-9)
+    }
+}
+TEST_CASE(stableIntervals_normal, stableIntervals, Z::Enums::StabilityCalcMode::Normal)
+TEST_CASE(stableIntervals_squared, stableIntervals, Z::Enums::StabilityCalcMode::Squared)
+
 TEST_GROUP("StabilityMapFunction",
            ADD_TEST(calculate_normal),
            ADD_TEST(calculate_squared),
            ADD_TEST(calculateAt),
+           ADD_TEST(calculate_adaptive),
+           ADD_TEST(stableIntervals_normal),
+           ADD_TEST(stableIntervals_squared),
            )
 } // namespace StabilityMap
 
@@ -293,10 +355,171 @@ TEST_METHOD(calculateAt)
     ASSERT_NEAR_TS(func.calculateAt(12_cm, 30_cm), -184.537358, -167.424983, 1e-6)
 }
 
+TEST_CASE_METHOD(calculate_parallel, bool compiled)
+{
+    TEST_SCHEMA(TripType::SW)
+    StabilityMap2DFunction func(s.schema);
+    func.paramX()->element = s.elem_L_foc;
+    func.paramX()->parameter = s.elem_L_foc->paramLength();
+    func.paramX()->range = Z::VariableRange::withPoints(0_mm, 100_mm, 37);
+    func.paramY()->element = s.elem_L;
+    // IOR of empty range can't be compiled, the function varies it in evaluation contexts
+    func.paramY()->parameter = compiled ? s.elem_L->paramLength() : s.elem_L->paramIor();
+    func.paramY()->range = compiled
+            ? Z::VariableRange::withPoints(0_mm, 500_mm, 23)
+            : Z::VariableRange::withPoints(Z::Value(1, Z::Units::none()), Z::Value(2, Z::Units::none()), 23);
+
+    auto& settings = AppSettings::instance();
+    int oldThreadCount = settings.calcThreadCount;
+
+    settings.calcThreadCount = 1;
+    func.calculate();
+    ASSERT_FUNC_OK
+    auto serialT = func.resultsT();
+    auto serialS = func.resultsS();
+
+    for (int threadCount : {2, 3, 8})
+    {
+        settings.calcThreadCount = threadCount;
+        func.calculate();
+        ASSERT_FUNC_OK
+        ASSERT_NEAR_DBL_ARR(func.resultsT(), serialT, 0)
+        ASSERT_NEAR_DBL_ARR(func.resultsS(), serialS, 0)
+    }
+
+    settings.calcThreadCount = oldThreadCount;
+}
+
+TEST_CASE(calculate_parallel_compiled, calculate_parallel, true)
+TEST_CASE(calculate_parallel_context, calculate_parallel, false)
+
+TEST_METHOD(calculate_disabled_element)
+{
+    TEST_SCHEMA(TripType::SW)
+    s.elem_M_foc->setDisabled(true);
+    s.elem_M_foc->calcMatrix("test");
+    StabilityMap2DFunction func(s.schema);
+    func.paramX()->element = s.elem_L_foc;
+    func.paramX()->parameter = s.elem_L_foc->paramLength();
+    func.paramX()->range = Z::VariableRange::withPoints(0_mm, 100_mm, 5);
+    func.paramY()->element = s.elem_M_foc;
+    func.paramY()->parameter = s.elem_M_foc->params().byAlias("R");
+    func.paramY()->range = Z::VariableRange::withPoints(20_mm, 200_mm, 5);
+    func.calculate();
+    ASSERT_FUNC_OK
+
+    // Disabled mirror doesn't change the round-trip whatever its curvature is,
+    // each point must be the same as calculated directly in the schema
+    auto rangeX = func.rangeX();
+    auto rangeY = func.rangeY();
+    auto valuesX = rangeX.values();
+    auto valuesY = rangeY.values();
+    int ny = valuesY.size();
+    for (int ix = 0; ix < valuesX.size(); ix++)
+        for (int iy = 0; iy < ny; iy++)
+        {
+            auto res = func.calculateAt(Z::Value(valuesX.at(ix), rangeX.unit()), Z::Value(valuesY.at(iy), rangeY.unit()));
+            ASSERT_NEAR_DBL(func.resultsT().at(ix * ny + iy), res.T, 1e-12)
+            ASSERT_NEAR_DBL(func.resultsS().at(ix * ny + iy), res.S, 1e-12)
+        }
+}
+
+TEST_METHOD(calculate_adaptive)
+{
+    TEST_SCHEMA(TripType::SW)
+    StabilityMap2DFunction func(s.schema);
+    func.paramX()->element = s.elem_L_foc;
+    func.paramX()->parameter = s.elem_L_foc->paramLength();
+    func.paramX()->range = Z::VariableRange::withPoints(0_mm, 100_mm, 201);
+    func.paramY()->element = s.elem_L;
+    func.paramY()->parameter = s.elem_L->paramLength();
+    func.paramY()->range = Z::VariableRange::withPoints(0_mm, 500_mm, 201);
+    func.calculate();
+    ASSERT_FUNC_OK
+    auto fullT = func.resultsT();
+    auto fullS = func.resultsS();
+    int count = fullT.size();
+    ASSERT_EQ_INT(func.evaluations(), count)
+
+    func.setAdaptive(true);
+    func.calculate();
+    ASSERT_FUNC_OK
+    TEST_LOG(QString("Evaluations: %1 of %2").arg(func.evaluations()).arg(count))
+    ASSERT_IS_TRUE(func.evaluations() < count / 2)
+
+    // Stable and unstable regions should be the same as in the full map
+    int mismatches = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if ((qAbs(fullT.at(i)) < 1) != (qAbs(func.resultsT().at(i)) < 1)) mismatches++;
+        if ((qAbs(fullS.at(i)) < 1) != (qAbs(func.resultsS().at(i)) < 1)) mismatches++;
+    }
+    TEST_LOG(QString("Mismatches: %1").arg(mismatches))
+    ASSERT_IS_TRUE(mismatches <= count / 1000)
+
+    // Full map is calculated when cells can't be coarser than points
+    func.setAdaptiveCellSize(1);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_EQ_INT(func.evaluations(), count)
+    ASSERT_NEAR_DBL_ARR(func.resultsT(), fullT, 0)
+    ASSERT_NEAR_DBL_ARR(func.resultsS(), fullS, 0)
+}
+
+TEST_METHOD(calculate_job)
+{
+    TEST_STAB_MAP_2D_FUNC(Z::Enums::StabilityCalcMode::Normal)
+    auto resultsT = func.resultsT();
+    auto resultsS = func.resultsS();
+
+    // The job doesn't depend on changes made in the schema or in function options after it has been prepared
+    auto job = func.prepareJob();
+    ASSERT_IS_TRUE(bool(job))
+    auto paramR = s.elem_M_foc->params().byAlias("R");
+    auto valueR = paramR->value();
+    paramR->setValue(100_mm);
+    func.setAdaptive(true);
+    std::atomic<bool> cancelled(false);
+    job(cancelled);
+    func.finishJob();
+    ASSERT_NEAR_DBL_ARR(func.resultsT(), resultsT, 0)
+    ASSERT_NEAR_DBL_ARR(func.resultsS(), resultsS, 0)
+    ASSERT_EQ_INT(func.evaluations(), resultsT.size())
+
+    // The job calculates into its own buffers, results of the function are only changed when it's finished
+    func.setAdaptive(false);
+    job = func.prepareJob();
+    ASSERT_IS_TRUE(bool(job))
+    job(cancelled);
+    ASSERT_NEAR_DBL_ARR(func.resultsT(), resultsT, 0)
+    ASSERT_NEAR_DBL_ARR(func.resultsS(), resultsS, 0)
+
+    // Cancelled job stops without calculating anything and its results are dropped
+    paramR->setValue(valueR);
+    job = func.prepareJob();
+    ASSERT_IS_TRUE(bool(job))
+    cancelled = true;
+    job(cancelled);
+    ASSERT_NEAR_DBL_ARR(func.resultsT(), resultsT, 0)
+    ASSERT_NEAR_DBL_ARR(func.resultsS(), resultsS, 0)
+    ASSERT_EQ_INT(func.evaluations(), resultsT.size())
+
+    // Job can't be prepared for invalid arguments
+    func.paramY()->parameter = nullptr;
+    job = func.prepareJob();
+    ASSERT_IS_FALSE(bool(job))
+    ASSERT_IS_FALSE(func.ok())
+}
+
 TEST_GROUP("StabilityMap2DFunction",
            ADD_TEST(calculate_normal),
            ADD_TEST(calculate_squared),
            ADD_TEST(calculateAt),
+           ADD_TEST(calculate_parallel_compiled),
+           ADD_TEST(calculate_parallel_context),
+           ADD_TEST(calculate_disabled_element),
+           ADD_TEST(calculate_adaptive),
+           ADD_TEST(calculate_job),
            )
 } // namespace StabilityMap2
 
@@ -404,15 +627,152 @@ TEST_METHOD(calculateAt_SP_R)
     ASSERT_NEAR_TS(func.calculateAt(0.057), 0.0388935389, 0.0385073863, 1e-10)
 }
 
+TEST_METHOD(calculate_adaptive_R)
+{
+    TEST_CAUSTIC_FUNC(TripType::SW, CausticFunction::Mode::FrontRadius)
+    func.setAdaptive(true);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_FUNC_RESULT_COUNT(2)
+    for (auto plane : { Z::WorkPlane::Plane_T, Z::WorkPlane::Plane_S })
+    {
+        // Segments are still split at the pole, but their ends are much closer to it
+        auto res1 = func.result(plane, 0);
+        auto res2 = func.result(plane, 1);
+        TEST_LOG(QString("Points count: %1 + %2").arg(res1.pointsCount()).arg(res2.pointsCount()))
+        ASSERT_IS_TRUE(res1.pointsCount() + res2.pointsCount() <= 40)
+        ASSERT_NEAR_DBL(res1.x().first(), 0, 1e-12)
+        ASSERT_NEAR_DBL(res2.x().last(), 0.056, 1e-12)
+        ASSERT_IS_TRUE(res1.x().last() > 0.0248888889)
+        ASSERT_IS_TRUE(res2.x().first() < 0.0311111111)
+        ASSERT_IS_TRUE(res2.x().first() - res1.x().last() < 0.001)
+        for (auto res : { res1, res2 })
+        {
+            for (int i = 1; i < res.pointsCount(); i++)
+                ASSERT_IS_TRUE(res.x().at(i) > res.x().at(i-1))
+            for (int i = 0; i < res.pointsCount(); i++)
+            {
+                auto p = func.calculateAt(res.x().at(i));
+                ASSERT_NEAR_DBL(res.y().at(i), plane == Z::WorkPlane::Plane_T ? p.T : p.S, 1e-12)
+            }
+        }
+    }
+}
+
+TEST_CASE_METHOD(calculate_homogeneous, TripType tripType, CausticFunction::Mode mode)
+{
+    TEST_CAUSTIC_FUNC(tripType, mode)
+    ASSERT_IS_TRUE(s.elem_L_foc->isHomogeneous())
+    auto results = func.result(Z::Plane_T, 0);
+
+    // Points calculated in closed form must be the same as those from full round-trips
+    RoundTripCalculator calc(s.schema, s.elem_L_foc);
+    calc.calcRoundTrip(true);
+    AbcdBeamCalculator beamCalc(s.schema->wavelenSi());
+    Z::PairTS<std::shared_ptr<PumpCalculator>> pumpCalc;
+    ASSERT_EQ_STR(FunctionUtils::preparePumpCalculator(s.schema, nullptr, pumpCalc), "")
+    for (int i = 0; i < results.pointsCount(); i++)
+    {
+        s.elem_L_foc->setSubRangeSI(results.x().at(i));
+        calc.multMatrix();
+        double expected;
+        if (tripType == TripType::SP)
+        {
+            auto beam = pumpCalc.T->calc(calc.Mt(), 1);
+            expected = mode == CausticFunction::Mode::BeamRadius ? beam.beamRadius : beam.halfAngle;
+        }
+        else
+            expected = mode == CausticFunction::Mode::BeamRadius
+                ? beamCalc.beamRadius(calc.Mt(), 1) : beamCalc.halfAngle(calc.Mt(), 1);
+        ASSERT_NEAR_DBL(results.y().at(i), expected, qAbs(expected) * 1e-9)
+    }
+}
+TEST_CASE(calculate_homogeneous_resonator_W, calculate_homogeneous, TripType::SW, CausticFunction::Mode::BeamRadius)
+TEST_CASE(calculate_homogeneous_resonator_V, calculate_homogeneous, TripType::SW, CausticFunction::Mode::HalfAngle)
+TEST_CASE(calculate_homogeneous_SP_W, calculate_homogeneous, TripType::SP, CausticFunction::Mode::BeamRadius)
+TEST_CASE(calculate_homogeneous_SP_V, calculate_homogeneous, TripType::SP, CausticFunction::Mode::HalfAngle)
+
+TEST_METHOD(calculate_cached)
+{
+    TEST_CAUSTIC_FUNC(TripType::SW, CausticFunction::Mode::BeamRadius)
+    auto& cache = ResultCache::instance();
+    auto results = func.result(Z::Plane_T, 0).y();
+
+    auto lambda = s.schema->wavelength().value();
+    s.schema->wavelength().setValue(1064_nm);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_IS_FALSE(func.result(Z::Plane_T, 0).y() == results)
+
+    // Results for the same inputs are taken from the cache
+    int hits = cache.hits();
+    s.schema->wavelength().setValue(lambda);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_EQ_INT(cache.hits(), hits + 1)
+    ASSERT_NEAR_DBL_ARR(func.result(Z::Plane_T, 0).y(), results, 0)
+
+    // Function mode is a part of the key
+    func.setMode(CausticFunction::Mode::HalfAngle);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_IS_FALSE(func.result(Z::Plane_T, 0).y() == results)
+}
+
+TEST_METHOD(inputs_SP)
+{
+    TEST_CAUSTIC_FUNC(TripType::SP, CausticFunction::Mode::BeamRadius)
+    auto inputs = func.inputs();
+    ASSERT_IS_FALSE(inputs.allElements)
+    ASSERT_IS_TRUE(inputs.pump)
+    ASSERT_IS_TRUE(inputs.wavelength)
+    ASSERT_IS_TRUE(inputs.elements.contains(s.elem_M_back))
+    ASSERT_IS_TRUE(inputs.elements.contains(s.elem_L_foc))
+    ASSERT_IS_FALSE(inputs.elements.contains(s.elem_L))
+    ASSERT_IS_FALSE(inputs.elements.contains(s.elem_M_out))
+
+    SchemaChanges changes;
+    changes.elements << s.elem_M_out;
+    ASSERT_IS_FALSE(func.isAffectedBy(changes))
+    changes.elements << s.elem_M_back;
+    ASSERT_IS_TRUE(func.isAffectedBy(changes))
+    changes.clear();
+    changes.pump = true;
+    ASSERT_IS_TRUE(func.isAffectedBy(changes))
+}
+
+TEST_METHOD(inputs_resonator)
+{
+    TEST_CAUSTIC_FUNC(TripType::SW, CausticFunction::Mode::BeamRadius)
+    auto inputs = func.inputs();
+    ASSERT_IS_FALSE(inputs.allElements)
+    ASSERT_IS_FALSE(inputs.pump)
+    ASSERT_IS_TRUE(inputs.elements.contains(s.elem_M_out))
+
+    SchemaChanges changes;
+    changes.pump = true;
+    ASSERT_IS_FALSE(func.isAffectedBy(changes))
+    changes.all = true;
+    ASSERT_IS_TRUE(func.isAffectedBy(changes))
+}
+
 TEST_GROUP("CausticFunction",
            ADD_TEST(calculate_resonator_W),
            ADD_TEST(calculate_resonator_R),
+           ADD_TEST(calculate_adaptive_R),
            ADD_TEST(calculateAt_resonator_W),
            ADD_TEST(calculateAt_resonator_R),
            ADD_TEST(calculate_SP_W),
            ADD_TEST(calculate_SP_R),
            ADD_TEST(calculateAt_SP_W),
            ADD_TEST(calculateAt_SP_R),
+           ADD_TEST(calculate_homogeneous_resonator_W),
+           ADD_TEST(calculate_homogeneous_resonator_V),
+           ADD_TEST(calculate_homogeneous_SP_W),
+           ADD_TEST(calculate_homogeneous_SP_V),
+           ADD_TEST(calculate_cached),
+           ADD_TEST(inputs_SP),
+           ADD_TEST(inputs_resonator),
            )
 
 } // namespace Caustic
@@ -590,12 +950,329 @@ TEST_GROUP("MultirangeCausticFunction",
 
 //------------------------------------------------------------------------------
 
+namespace MultibeamCaustic {
+
+static QVector<Z::Variable> makeArgs(const TestSchema& s)
+{
+    QVector<Z::Variable> args;
+    for (Element* elem : { (Element*)s.elem_L_foc, (Element*)s.elem_L })
+    {
+        Z::Variable v;
+        v.element = elem;
+        v.range.start = 0_m;
+        v.range.stop = 0_m;
+        v.range.step = 0_m;
+        v.range.points = 10;
+        args << v;
+    }
+    return args;
+}
+
+TEST_CASE_METHOD(calculatePumps, CausticFunction::Mode mode)
+{
+    TEST_SCHEMA(TripType::SP)
+    MultibeamCausticFunction func(s.schema);
+    func.setArgs(makeArgs(s));
+    static_cast<MultirangeCausticFunction&>(func).setMode(mode);
+    func.calculatePumps(*s.schema->pumps());
+
+    // Each pump must give the same beam as if it is calculated separately
+    MultirangeCausticFunction expected(s.schema);
+    expected.setArgs(makeArgs(s));
+    expected.setMode(mode);
+    for (auto pump : *s.schema->pumps())
+    {
+        TEST_LOG(pump->label())
+        ASSERT_IS_TRUE(func.selectPump(pump))
+        ASSERT_FUNC_OK
+        expected.setPump(pump);
+        expected.calculate();
+        ASSERT_IS_TRUE(expected.ok())
+        for (auto plane : { Z::Plane_T, Z::Plane_S })
+        {
+            ASSERT_EQ_INT(func.resultCount(plane), expected.resultCount(plane))
+            for (int i = 0; i < func.resultCount(plane); i++)
+            {
+                ASSERT_NEAR_DBL_ARR(func.result(plane, i).x(), expected.result(plane, i).x(), 0)
+                ASSERT_NEAR_DBL_ARR(func.result(plane, i).y(), expected.result(plane, i).y(), 1e-12)
+            }
+        }
+        auto p = func.calculateAt(0.2);
+        auto p1 = expected.calculateAt(0.2);
+        ASSERT_NEAR_TS(p, p1.T, p1.S, 1e-12)
+    }
+
+    // Pumps are different, so are their beams
+    ASSERT_IS_TRUE(func.selectPump(s.schema->pumps()->at(1)))
+    auto y1 = func.result(Z::Plane_T, 0).y();
+    ASSERT_IS_TRUE(func.selectPump(s.schema->pumps()->at(0)))
+    ASSERT_IS_FALSE(func.result(Z::Plane_T, 0).y() == y1)
+}
+TEST_CASE(calculatePumps_W, calculatePumps, CausticFunction::Mode::BeamRadius)
+TEST_CASE(calculatePumps_R, calculatePumps, CausticFunction::Mode::FrontRadius)
+
+TEST_METHOD(selectPump_not_calculated)
+{
+    TEST_SCHEMA(TripType::SP)
+    MultibeamCausticFunction func(s.schema);
+    func.setArgs(makeArgs(s));
+    ASSERT_IS_FALSE(func.selectPump(s.schema->pumps()->at(0)))
+    ASSERT_IS_FALSE(func.ok())
+
+    func.calculatePumps({s.schema->pumps()->at(0)});
+    ASSERT_IS_TRUE(func.selectPump(s.schema->pumps()->at(0)))
+    ASSERT_IS_FALSE(func.selectPump(s.schema->pumps()->at(1)))
+}
+
+TEST_GROUP("MultibeamCausticFunction",
+           ADD_TEST(calculatePumps_W),
+           ADD_TEST(calculatePumps_R),
+           ADD_TEST(selectPump_not_calculated),
+           )
+} // namespace MultibeamCaustic
+
+//------------------------------------------------------------------------------
+
+namespace EvalContextTests {
+
+TEST_METHOD(context_clones_schema)
+{
+    TEST_SCHEMA(TripType::SW)
+    EvalContext context(s.schema);
+    ASSERT_EQ_INT(context.schema()->count(), s.schema->count())
+    for (int i = 0; i < s.schema->count(); i++)
+    {
+        auto elem = s.schema->element(i);
+        auto copy = context.element(elem);
+        ASSERT_IS_NOT_NULL(copy)
+        ASSERT_IS_TRUE(copy != elem)
+        ASSERT_IS_TRUE(copy == context.schema()->element(i))
+        ASSERT_EQ_MATRIX(copy->Mt(), elem->Mt())
+        ASSERT_EQ_MATRIX(copy->Ms(), elem->Ms())
+    }
+    RoundTripCalculator calc(s.schema, s.elem_L_foc);
+    calc.calcRoundTrip();
+    calc.multMatrix();
+    RoundTripCalculator calc1(context.schema(), context.element(s.elem_L_foc));
+    calc1.calcRoundTrip();
+    calc1.multMatrix();
+    ASSERT_EQ_MATRIX(calc1.Mt(), calc.Mt())
+    ASSERT_EQ_MATRIX(calc1.Ms(), calc.Ms())
+}
+
+TEST_METHOD(setParamValue_keeps_source)
+{
+    TEST_SCHEMA(TripType::SW)
+    EvalContext context(s.schema);
+    context.setParamValue(s.elem_L->paramLength(), 100_mm);
+    ASSERT_EQ_ZVALUE(s.elem_L->paramLength()->value(), 420_mm)
+    ASSERT_MATRIX_NEAR(s.elem_L->Mt(), 1, 0.42, 0, 1, 1e-12)
+    auto copy = context.element(s.elem_L);
+    ASSERT_EQ_ZVALUE(context.param(s.elem_L->paramLength())->value(), 100_mm)
+    ASSERT_MATRIX_NEAR(copy->Mt(), 1, 0.1, 0, 1, 1e-12)
+}
+
+TEST_METHOD(function_keeps_source)
+{
+    TEST_SCHEMA(TripType::SW)
+    StabilityMapFunction func(s.schema);
+    func.arg()->element = s.elem_L_foc;
+    func.arg()->parameter = s.elem_L_foc->paramLength();
+    func.arg()->range = Z::VariableRange::withPoints(24_mm, 60_mm, 10);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_EQ_ZVALUE(s.elem_L_foc->paramLength()->value(), 56_mm)
+    ASSERT_MATRIX_NEAR(s.elem_L_foc->Mt(), 1, 0.056, 0, 1, 1e-12)
+}
+
+TEST_GROUP("EvalContext",
+           ADD_TEST(context_clones_schema),
+           ADD_TEST(setParamValue_keeps_source),
+           ADD_TEST(function_keeps_source),
+           )
+} // namespace EvalContextTests
+
+//------------------------------------------------------------------------------
+
+namespace OpticalProgramTests {
+
+#define TEST_PROGRAM_SCHEMA(tripType) \
+    Schema schema; \
+    schema.setTripType(tripType); \
+    auto M1 = makeElem<ElemCurveMirror>("M1", "R=100 mm; Alpha=5 deg"); \
+    auto d1 = makeElem<ElemEmptyRange>("d1", "L=100 mm"); \
+    auto s1 = new ElemNormalInterface; \
+    auto G = makeElem<ElemMediumRange>("G", "L=20 mm; n=1.5"); \
+    auto s2 = new ElemBrewsterInterface; \
+    auto d2 = makeElem<ElemEmptyRange>("d2", "L=50 mm"); \
+    auto F = makeElem<ElemThinLens>("F", "F=80 mm; Alpha=10 deg"); \
+    auto d3 = makeElem<ElemPlate>("d3", "L=30 mm; n=1.2"); \
+    auto M2 = new ElemFlatMirror; \
+    schema.insertElements({M1, d1, s1, G, s2, d2, F, d3, M2}, -1, Arg::RaiseEvents(false)); \
+    RoundTripCalculator calc(&schema, tripType == TripType::SP ? M2 : d1); \
+    calc.calcRoundTrip(); \
+    calc.multMatrix();
+
+#define ASSERT_PROGRAM_SAME_AS_CALC \
+    program.run(); \
+    calc.multMatrix(); \
+    ASSERT_NEAR_MATRIX(program.Mt(), calc.Mt(), 1e-12) \
+    ASSERT_NEAR_MATRIX(program.Ms(), calc.Ms(), 1e-12)
+
+TEST_CASE_METHOD(program_same_as_calculator, TripType tripType)
+{
+    TEST_PROGRAM_SCHEMA(tripType)
+
+    OpticalProgram program;
+    ASSERT_IS_TRUE(program.compile(&calc, {G, F, M1, d3}))
+    ASSERT_PROGRAM_SAME_AS_CALC
+
+    int slotL = program.slot(G->paramLength());
+    int slotN = program.slot(G->paramIor());
+    int slotF = program.slot(F->params().byAlias("F"));
+    int slotR = program.slot(M1->params().byAlias("R"));
+    int slotL3 = program.slot(d3->paramLength());
+    ASSERT_IS_TRUE(slotL >= 0)
+    ASSERT_IS_TRUE(slotN >= 0)
+    ASSERT_IS_TRUE(slotF >= 0)
+    ASSERT_IS_TRUE(slotR >= 0)
+    ASSERT_IS_TRUE(slotL3 >= 0)
+    // interfaces take IOR from the medium
+    ASSERT_EQ_INT(program.slot(s1->paramIor2()), -1)
+
+    program.setSlot(slotL, 0.03);
+    G->paramLength()->setValue(30_mm);
+    ASSERT_PROGRAM_SAME_AS_CALC
+
+    program.setSlot(slotN, 2.1);
+    G->paramIor()->setValue(2.1);
+    ASSERT_PROGRAM_SAME_AS_CALC
+
+    program.setSlot(slotF, -0.15);
+    F->params().byAlias("F")->setValue(-150_mm);
+    program.setSlot(slotR, 0.25);
+    M1->params().byAlias("R")->setValue(250_mm);
+    program.setSlot(slotL3, 0.01);
+    d3->paramLength()->setValue(10_mm);
+    ASSERT_PROGRAM_SAME_AS_CALC
+}
+
+TEST_CASE(program_same_as_calculator_SW, program_same_as_calculator, TripType::SW)
+TEST_CASE(program_same_as_calculator_RR, program_same_as_calculator, TripType::RR)
+TEST_CASE(program_same_as_calculator_SP, program_same_as_calculator, TripType::SP)
+
+TEST_METHOD(program_folds_constant_elements)
+{
+    TEST_PROGRAM_SCHEMA(TripType::SW)
+    OpticalProgram program;
+    ASSERT_IS_TRUE(program.compile(&calc, {}))
+    ASSERT_EQ_INT(program.opsCount(), 1)
+    ASSERT_PROGRAM_SAME_AS_CALC
+    // SW round-trip from d1: d1 M1 d1 s1 G s2 d2 F d3 M2 d3 F d2 s2 G s1
+    // s2 takes IOR from d2, so it is varied too
+    ASSERT_IS_TRUE(program.compile(&calc, {d2}))
+    ASSERT_EQ_INT(program.opsCount(), 7)
+    ASSERT_PROGRAM_SAME_AS_CALC
+}
+
+TEST_CASE_METHOD(program_split, TripType tripType)
+{
+    TEST_PROGRAM_SCHEMA(tripType)
+    OpticalProgram program;
+    ASSERT_IS_TRUE(program.compile(&calc, {d1, d3}))
+    int slotX = program.slot(d1->paramLength());
+    int slotY = program.slot(d3->paramLength());
+    OpticalProgram partX, partY;
+    ASSERT_IS_TRUE(program.split(slotX, slotY, partX, partY))
+    for (double x : {0.01, 0.05, 0.2})
+        for (double y : {0.001, 0.03})
+        {
+            program.setSlot(slotX, x);
+            program.setSlot(slotY, y);
+            program.run();
+            partX.setSlot(slotX, x);
+            partX.run();
+            partY.setSlot(slotY, y);
+            partY.run();
+            Z::RealMatrix mt(partX.realMt()), ms(partX.realMs());
+            mt *= partY.realMt();
+            ms *= partY.realMs();
+            ASSERT_NEAR_DBL(mt.A + mt.D, program.realMt().A + program.realMt().D, 1e-12)
+            ASSERT_NEAR_DBL(ms.A + ms.D, program.realMs().A + program.realMs().D, 1e-12)
+        }
+}
+
+TEST_CASE(program_split_SW, program_split, TripType::SW)
+TEST_CASE(program_split_RR, program_split, TripType::RR)
+TEST_CASE(program_split_SP, program_split, TripType::SP)
+
+TEST_METHOD(program_split_fails_for_dependent_slots)
+{
+    TEST_PROGRAM_SCHEMA(TripType::SW)
+    OpticalProgram program;
+    ASSERT_IS_TRUE(program.compile(&calc, {d1, G}))
+    // interface s1 takes IORs from both d1 and G
+    int slotX = program.slot(d1->paramIor());
+    int slotY = program.slot(G->paramIor());
+    OpticalProgram partX, partY;
+    ASSERT_IS_FALSE(program.split(slotX, slotY, partX, partY))
+}
+
+TEST_METHOD(program_skips_disabled_elements)
+{
+    TEST_PROGRAM_SCHEMA(TripType::SW)
+    F->setDisabled(true);
+    F->calcMatrix("test");
+    OpticalProgram program;
+    ASSERT_IS_TRUE(program.compile(&calc, {F, d3}))
+    ASSERT_EQ_INT(program.slot(F->params().byAlias("F")), -1)
+    int slotL3 = program.slot(d3->paramLength());
+    ASSERT_IS_TRUE(slotL3 >= 0)
+    ASSERT_PROGRAM_SAME_AS_CALC
+
+    F->params().byAlias("F")->setValue(-150_mm);
+    program.setSlot(slotL3, 0.01);
+    d3->paramLength()->setValue(10_mm);
+    ASSERT_PROGRAM_SAME_AS_CALC
+}
+
+TEST_METHOD(program_rejects_unsupported_elements)
+{
+    TEST_PROGRAM_SCHEMA(TripType::SW)
+    auto T = makeElem<ElemTiltedCrystal>("T", "L=10 mm; n=1.5; Alpha=10 deg");
+    schema.insertElements({T}, 2, Arg::RaiseEvents(false));
+    calc.calcRoundTrip();
+    OpticalProgram program;
+    ASSERT_IS_TRUE(program.compile(&calc, {G}))
+    ASSERT_IS_FALSE(program.compile(&calc, {T}))
+    TEST_LOG(program.error())
+}
+
+TEST_GROUP("OpticalProgram",
+           ADD_TEST(program_same_as_calculator_SW),
+           ADD_TEST(program_same_as_calculator_RR),
+           ADD_TEST(program_same_as_calculator_SP),
+           ADD_TEST(program_folds_constant_elements),
+           ADD_TEST(program_split_SW),
+           ADD_TEST(program_split_RR),
+           ADD_TEST(program_split_SP),
+           ADD_TEST(program_split_fails_for_dependent_slots),
+           ADD_TEST(program_skips_disabled_elements),
+           ADD_TEST(program_rejects_unsupported_elements),
+           )
+} // namespace OpticalProgramTests
+
+//------------------------------------------------------------------------------
+
 TEST_GROUP("Plot functions",
+           ADD_GROUP(EvalContextTests),
+           ADD_GROUP(OpticalProgramTests),
            ADD_GROUP(StabilityMap),
            ADD_GROUP(StabilityMap2D),
            ADD_GROUP(Caustic),
            ADD_GROUP(BeamVariation),
            ADD_GROUP(MultirangeCaustic),
+           ADD_GROUP(MultibeamCaustic),
            )
 
 } // namespace PlotFunctionsTests
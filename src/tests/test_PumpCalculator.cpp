@@ -249,6 +249,73 @@ TEST_METHOD(InvComplex_hyper)
     ASSERT_NEAR_DBL(beam.halfAngle, 0.004573194, 1e-9)
 }
 
+// Batch must give the same values as separate calculation of each matrix
+#define ASSERT_BATCH_SAME_AS_SINGLE(calc, matrices, ior) {\
+    Z::MatrixBatch batch;\
+    for (const Matrix& m : matrices)\
+        batch.append(m);\
+    QVector<double> w(batch.size()), r(batch.size()), v(batch.size());\
+    calc->calc(batch, ior, w.data(), r.data(), v.data());\
+    for (int i = 0; i < batch.size(); i++)\
+    {\
+        BeamResult beam = calc->calc(matrices.at(i), ior);\
+        ASSERT_NEAR_DBL(w.at(i), beam.beamRadius, qAbs(beam.beamRadius) * 1e-12)\
+        ASSERT_NEAR_DBL(r.at(i), beam.frontRadius, qAbs(beam.frontRadius) * 1e-12)\
+        ASSERT_NEAR_DBL(v.at(i), beam.halfAngle, qAbs(beam.halfAngle) * 1e-12)\
+    }\
+}
+
+TEST_METHOD(calc_batch_gauss)
+{
+    PumpParams_Waist p;
+    p.waist()->setValue(100_mkm);
+    p.distance()->setValue(10_cm);
+    p.MI()->setValue(3);
+
+    auto calc = PumpCalculator::T();
+    ASSERT_IS_TRUE(calc->init(&p, 980e-9));
+
+    QVector<Matrix> matrices {
+        Matrix(),
+        { -1.3899498, 0.1731843, -9.8480800, 0.5075960 },
+        { -1.4379022, 0.1681906, -10.1543000, 0.4922850 },
+        { 1, 0.05, 0, 1 },
+    };
+    ASSERT_BATCH_SAME_AS_SINGLE(calc, matrices, 1)
+    ASSERT_BATCH_SAME_AS_SINGLE(calc, matrices, 1.5)
+
+    // Complex matrices are calculated one by one
+    matrices << Matrix(Complex(1, 0), Complex(0.01, 0), Complex(0, -100), Complex(1, 0));
+    ASSERT_BATCH_SAME_AS_SINGLE(calc, matrices, 1)
+}
+
+TEST_METHOD(calc_batch_ray_vector)
+{
+    PumpParams_RayVector p;
+    p.radius()->setValue(1.5_mm);
+    p.angle()->setValue(5_deg);
+    p.distance()->setValue(10_cm);
+
+    auto calc = PumpCalculator::T();
+    ASSERT_IS_TRUE(calc->init(&p, 0));
+
+    QVector<Matrix> matrices {
+        Matrix(),
+        { -1.4379022, 0.1681906, -10.1543000, 0.4922850 },
+        { 1, 0.05, 0, 1 },
+    };
+    ASSERT_BATCH_SAME_AS_SINGLE(calc, matrices, 1)
+
+    // Geometric pump gives nothing for complex matrices
+    Z::MatrixBatch batch;
+    batch.append(Matrix(Complex(1, 0), Complex(0.01, 0), Complex(0, -100), Complex(1, 0)));
+    double w, r, v;
+    calc->calc(batch, 1, &w, &r, &v);
+    ASSERT_IS_TRUE(std::isnan(w))
+    ASSERT_IS_TRUE(std::isnan(r))
+    ASSERT_IS_TRUE(std::isnan(v))
+}
+
 //------------------------------------------------------------------------------
 
 TEST_GROUP("PumpCalculator",
@@ -262,6 +329,8 @@ TEST_GROUP("PumpCalculator",
            ADD_TEST(Complex_hyper),
            ADD_TEST(InvComplex_gauss),
            ADD_TEST(InvComplex_hyper),
+           ADD_TEST(calc_batch_gauss),
+           ADD_TEST(calc_batch_ray_vector),
            // TODO: add tests for calculation inside a medium
            )
 
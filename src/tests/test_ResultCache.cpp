@@ -0,0 +1,128 @@
+#include "testing/OriTestBase.h"
+#include "TestUtils.h"
+#include "../core/Elements.h"
+#include "../funcs/ResultCache.h"
+
+#include <memory>
+
+namespace Z {
+namespace Tests {
+namespace ResultCacheTests {
+
+static QByteArray makeKey(const QString& s, double v)
+{
+    ResultCache::Key key;
+    key << s << v;
+    return key.result();
+}
+
+TEST_METHOD(take_put)
+{
+    auto& cache = ResultCache::instance();
+    int oldLimit = cache.limit();
+    cache.clear();
+    cache.setLimit(1000);
+
+    QVector<double> value;
+    ASSERT_IS_FALSE(cache.take(makeKey("a", 1), value))
+    cache.put(makeKey("a", 1), QVector<double>({1, 2, 3}), 100);
+    ASSERT_IS_TRUE(cache.take(makeKey("a", 1), value))
+    ASSERT_IS_TRUE(value == QVector<double>({1, 2, 3}))
+
+    // Values of different types are stored separately
+    QString str;
+    ASSERT_IS_FALSE(cache.take(makeKey("a", 1), str))
+
+    ASSERT_EQ_INT(cache.hits(), 1)
+    ASSERT_EQ_INT(cache.misses(), 2)
+    ASSERT_EQ_INT(cache.size(), 100)
+
+    cache.clear();
+    cache.setLimit(oldLimit);
+}
+
+TEST_METHOD(lru_eviction)
+{
+    auto& cache = ResultCache::instance();
+    int oldLimit = cache.limit();
+    cache.clear();
+    cache.setLimit(300);
+
+    cache.put(makeKey("a", 0), 1, 100);
+    cache.put(makeKey("b", 0), 2, 100);
+    cache.put(makeKey("c", 0), 3, 100);
+    ASSERT_EQ_INT(cache.count(), 3)
+
+    // "a" becomes the most recently used, so "b" is evicted
+    int value;
+    ASSERT_IS_TRUE(cache.take(makeKey("a", 0), value))
+    cache.put(makeKey("d", 0), 4, 100);
+    ASSERT_EQ_INT(cache.count(), 3)
+    ASSERT_IS_FALSE(cache.take(makeKey("b", 0), value))
+    ASSERT_IS_TRUE(cache.take(makeKey("a", 0), value))
+    ASSERT_EQ_INT(value, 1)
+    ASSERT_IS_TRUE(cache.take(makeKey("c", 0), value))
+    ASSERT_IS_TRUE(cache.take(makeKey("d", 0), value))
+
+    // Too large value is not stored at all
+    cache.put(makeKey("e", 0), 5, 1000);
+    ASSERT_IS_FALSE(cache.take(makeKey("e", 0), value))
+    ASSERT_EQ_INT(cache.count(), 3)
+
+    // Zero limit disables caching
+    cache.setLimit(0);
+    cache.put(makeKey("a", 0), 1, 100);
+    ASSERT_IS_FALSE(cache.take(makeKey("a", 0), value))
+
+    cache.clear();
+    cache.setLimit(oldLimit);
+}
+
+TEST_METHOD(key)
+{
+    ASSERT_IS_TRUE(makeKey("a", 1) == makeKey("a", 1))
+    ASSERT_IS_FALSE(makeKey("a", 1) == makeKey("a", 2))
+    ASSERT_IS_FALSE(makeKey("a", 1) == makeKey("b", 1))
+
+    ResultCache::Key k1, k2;
+    k1 << QString("ab") << QString("c");
+    k2 << QString("a") << QString("bc");
+    ASSERT_IS_FALSE(k1.result() == k2.result())
+}
+
+TEST_METHOD(key_elements)
+{
+    auto makeElemKey = [](Element* elem){
+        ResultCache::Key key;
+        key << elem;
+        return key.result();
+    };
+    std::unique_ptr<ElemEmptyRange> elem1(new ElemEmptyRange);
+    std::unique_ptr<ElemEmptyRange> elem2(new ElemEmptyRange);
+    elem1->paramLength()->setValue(100_mm);
+    elem2->paramLength()->setValue(100_mm);
+    ASSERT_IS_TRUE(makeElemKey(elem1.get()) == makeElemKey(elem2.get()))
+
+    elem2->paramLength()->setValue(101_mm);
+    ASSERT_IS_FALSE(makeElemKey(elem1.get()) == makeElemKey(elem2.get()))
+
+    elem2->paramLength()->setValue(100_mm);
+    elem2->setDisabled(true);
+    ASSERT_IS_FALSE(makeElemKey(elem1.get()) == makeElemKey(elem2.get()))
+
+    std::unique_ptr<ElemPoint> elem3(new ElemPoint);
+    ASSERT_IS_FALSE(makeElemKey(elem1.get()) == makeElemKey(elem3.get()))
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("ResultCache",
+           ADD_TEST(take_put),
+           ADD_TEST(lru_eviction),
+           ADD_TEST(key),
+           ADD_TEST(key_elements),
+           )
+
+} // namespace ResultCacheTests
+} // namespace Tests
+} // namespace Z
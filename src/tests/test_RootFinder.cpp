@@ -0,0 +1,56 @@
+#include "testing/OriTestBase.h"
+#include "../funcs/RootFinder.h"
+
+#include <cmath>
+
+namespace Z {
+namespace Tests {
+namespace RootFinderTests {
+
+TEST_METHOD(brent)
+{
+    int count = 0;
+    auto f = [&count](double x){ count++; return x*x - 2; };
+    ASSERT_NEAR_DBL(RootFinder::brent(f, 0, 2), std::sqrt(2.0), 4e-16)
+    TEST_LOG(QString("Function calls: %1").arg(count))
+    ASSERT_IS_TRUE(count < 20)
+
+    auto g = [](double x){ return std::cos(x) - x; };
+    ASSERT_NEAR_DBL(RootFinder::brent(g, 0, 1), 0.7390851332151607, 2e-16)
+
+    // Multiple root, interpolation is poor and bisection does the work
+    auto h = [](double x){ return std::pow(x - 1e-3, 3); };
+    ASSERT_NEAR_DBL(RootFinder::brent(h, -1, 1), 1e-3, 1e-15)
+}
+
+TEST_METHOD(brent_known_values)
+{
+    int count = 0;
+    auto f = [&count](double x){ count++; return x - 0.25; };
+    ASSERT_NEAR_DBL(RootFinder::brent(f, 0, 1, -0.25, 0.75), 0.25, 1e-16)
+    ASSERT_IS_TRUE(count < 5)
+
+    // Root at an end of the bracket
+    ASSERT_EQ_DBL(RootFinder::brent(f, 0.25, 1, 0, 0.75), 0.25)
+    ASSERT_EQ_DBL(RootFinder::brent(f, 0, 0.25, -0.25, 0), 0.25)
+}
+
+TEST_METHOD(brent_invalid_bracket)
+{
+    auto f = [](double x){ return x*x - 2; };
+    ASSERT_IS_TRUE(std::isnan(RootFinder::brent(f, 2, 3)))
+    ASSERT_IS_TRUE(std::isnan(RootFinder::brent(f, -1, 1)))
+    ASSERT_IS_TRUE(std::isnan(RootFinder::brent(f, 0, 2, std::nan(""), 2)))
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("RootFinder",
+           ADD_TEST(brent),
+           ADD_TEST(brent_known_values),
+           ADD_TEST(brent_invalid_bracket),
+           )
+
+} // namespace RootFinderTests
+} // namespace Tests
+} // namespace Z
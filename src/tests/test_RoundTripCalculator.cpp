@@ -639,6 +639,182 @@ TEST_GROUP("Composite interfaced elements",
 )
 } // namespace InterfacedElements
 
+//------------------------------------------------------------------------------
+/**
+    Test that real-valued multiplication is used only when the round-trip can't produce
+    complex matrices, and that it gives the same result as complex multiplication.
+*/
+namespace RealRoundTrip {
+
+TEST_METHOD(rt_real_detected)
+{
+    TestData d(SW, RefIndex(0), {
+                   makeElem<ElemFlatMirror>("M1", ""),
+                   makeElem<ElemEmptyRange>("L1", "L = 100mm"),
+                   makeElem<ElemCurveMirror>("M2", "R = 200mm"),
+               });
+    d.calc->calcRoundTrip();
+    ASSERT_IS_TRUE(d.calc->isReal())
+}
+
+TEST_METHOD(rt_real_fallback_to_complex)
+{
+    TestData d(SW, RefIndex(0), {
+                   makeElem<ElemFlatMirror>("M1", ""),
+                   makeElem<ElemEmptyRange>("L1", "L = 100mm"),
+                   makeElem<ElemGaussAperture>("GA", ""),
+                   makeElem<ElemCurveMirror>("M2", "R = 200mm"),
+               });
+    d.calc->calcRoundTrip();
+    ASSERT_IS_FALSE(d.calc->isReal())
+}
+
+TEST_METHOD(rt_real_same_as_complex)
+{
+    TestData d(SW, RefIndex(1), {
+                   makeElem<ElemFlatMirror>("M1", ""),
+                   makeElem<ElemEmptyRange>("L1", "L = 100mm"),
+                   makeElem<ElemThickLens>("F1", "L=10mm; n = 2; R1=-90mm; R2=150mm"),
+                   makeElem<ElemEmptyRange>("L2", "L = 150mm"),
+                   makeElem<ElemCurveMirror>("M2", "R = 200mm"),
+               });
+    d.calc->calcRoundTrip();
+    ASSERT_IS_TRUE(d.calc->isReal())
+    d.calc->multMatrix();
+
+    Matrix mt, ms;
+    for (int i = 0; i < d.calc->matrsT().size(); i++)
+    {
+        mt *= d.calc->matrsT().at(i);
+        ms *= d.calc->matrsS().at(i);
+    }
+    ASSERT_EQ_MATRIX(d.calc->Mt(), mt)
+    ASSERT_EQ_MATRIX(d.calc->Ms(), ms)
+}
+
+TEST_GROUP("Real round-trip",
+           ADD_TEST(rt_real_detected),
+           ADD_TEST(rt_real_fallback_to_complex),
+           ADD_TEST(rt_real_same_as_complex),
+           )
+} // namespace RealRoundTrip
+
+//------------------------------------------------------------------------------
+/**
+    Test that cached products of constant parts of the round-trip
+    give the same round-trip matrix as multiplication of all matrices.
+*/
+namespace VariedElements {
+
+TEST_CASE_METHOD(rt_varied, TripType tripType, const RefIndex& refIndex, DoSplit&& doSplit)
+{
+    auto L2 = makeElem<ElemEmptyRange>("L2", "L = 150mm");
+    auto L3 = makeElem<ElemMediumRange>("L3", "L = 50mm; n = 1.5");
+    TestData d(tripType, refIndex, {
+                   makeElem<ElemFlatMirror>("M1", ""),
+                   makeElem<ElemEmptyRange>("L1", "L = 100mm"),
+                   makeElem<ElemThinLens>("F1", "F = 100mm"),
+                   L2,
+                   makeElem<ElemNormalInterface>("s1", ""),
+                   L3,
+                   makeElem<ElemNormalInterface>("s2", ""),
+                   makeElem<ElemCurveMirror>("M2", "R = 200mm"),
+               });
+    d.calc->calcRoundTrip(doSplit);
+    d.calc->setVariedElements({L2, L3});
+    ASSERT_IS_TRUE(d.calc->hasVariedElements())
+
+    RoundTripCalculator full(d.schema.data(), d.calc->reference());
+    full.calcRoundTrip(doSplit);
+
+    for (auto value : {120, 130, 140})
+    {
+        L2->paramLength()->setValue(Z::Value(value, Z::Units::mm()));
+        L3->paramIor()->setValue(value / 100.0);
+        d.calc->multMatrix();
+        full.multMatrix();
+        ASSERT_NEAR_MATRIX(d.calc->Mt(), full.Mt(), 1e-12)
+        ASSERT_NEAR_MATRIX(d.calc->Ms(), full.Ms(), 1e-12)
+    }
+
+    d.calc->resetVariedElements();
+    ASSERT_IS_FALSE(d.calc->hasVariedElements())
+}
+
+/// Round-trip refreshed by product trees must be the same as multiplication of all matrices,
+/// interfaces are not reported as changed, they must be refreshed as linked to the ranges.
+TEST_CASE_METHOD(rt_product_tree, TripType tripType, const RefIndex& refIndex, DoSplit&& doSplit)
+{
+    auto F1 = makeElem<ElemThinLens>("F1", "F = 100mm");
+    auto L2 = makeElem<ElemEmptyRange>("L2", "L = 150mm");
+    auto L3 = makeElem<ElemMediumRange>("L3", "L = 50mm; n = 1.5");
+    TestData d(tripType, refIndex, {
+                   makeElem<ElemFlatMirror>("M1", ""),
+                   makeElem<ElemEmptyRange>("L1", "L = 100mm"),
+                   F1,
+                   L2,
+                   makeElem<ElemNormalInterface>("s1", ""),
+                   L3,
+                   makeElem<ElemNormalInterface>("s2", ""),
+                   makeElem<ElemCurveMirror>("M2", "R = 200mm"),
+               });
+    d.calc->calcRoundTrip(doSplit);
+    d.calc->buildProductTree();
+    ASSERT_IS_TRUE(d.calc->hasProductTree())
+
+    RoundTripCalculator full(d.schema.data(), d.calc->reference());
+    full.calcRoundTrip(doSplit);
+    full.multMatrix();
+    ASSERT_NEAR_MATRIX(d.calc->Mt(), full.Mt(), 1e-12)
+    ASSERT_NEAR_MATRIX(d.calc->Ms(), full.Ms(), 1e-12)
+
+    for (auto value : {120, 130, 140})
+    {
+        F1->params().byAlias("F")->setValue(Z::Value(value, Z::Units::mm()));
+        L2->paramLength()->setValue(Z::Value(value, Z::Units::mm()));
+        L3->paramIor()->setValue(value / 100.0);
+        ASSERT_IS_TRUE(d.calc->updateElements({F1, L2, L3}))
+        full.multMatrix();
+        ASSERT_NEAR_MATRIX(d.calc->Mt(), full.Mt(), 1e-12)
+        ASSERT_NEAR_MATRIX(d.calc->Ms(), full.Ms(), 1e-12)
+    }
+
+    // Disabled element changes the round-trip itself, trees can't handle it
+    F1->setDisabled(true);
+    ASSERT_IS_FALSE(d.calc->updateElements({F1}))
+
+    d.calc->calcRoundTrip(doSplit);
+    ASSERT_IS_FALSE(d.calc->hasProductTree())
+}
+
+TEST_CASE(rt_varied_sw_0,       rt_varied, SW, RefIndex(0), DoSplit(false))
+TEST_CASE(rt_varied_sw_3,       rt_varied, SW, RefIndex(3), DoSplit(false))
+TEST_CASE(rt_varied_sw_3_split, rt_varied, SW, RefIndex(3), DoSplit(true))
+TEST_CASE(rt_varied_rr_1,       rt_varied, RR, RefIndex(1), DoSplit(false))
+TEST_CASE(rt_varied_rr_1_split, rt_varied, RR, RefIndex(1), DoSplit(true))
+TEST_CASE(rt_varied_sp_7,       rt_varied, SP, RefIndex(7), DoSplit(false))
+TEST_CASE(rt_varied_sp_5_split, rt_varied, SP, RefIndex(5), DoSplit(true))
+
+TEST_CASE(rt_product_tree_sw_0,       rt_product_tree, SW, RefIndex(0), DoSplit(false))
+TEST_CASE(rt_product_tree_sw_3_split, rt_product_tree, SW, RefIndex(3), DoSplit(true))
+TEST_CASE(rt_product_tree_rr_1,       rt_product_tree, RR, RefIndex(1), DoSplit(false))
+TEST_CASE(rt_product_tree_sp_7,       rt_product_tree, SP, RefIndex(7), DoSplit(false))
+
+TEST_GROUP("Varied elements",
+           ADD_TEST(rt_varied_sw_0),
+           ADD_TEST(rt_varied_sw_3),
+           ADD_TEST(rt_varied_sw_3_split),
+           ADD_TEST(rt_varied_rr_1),
+           ADD_TEST(rt_varied_rr_1_split),
+           ADD_TEST(rt_varied_sp_7),
+           ADD_TEST(rt_varied_sp_5_split),
+           ADD_TEST(rt_product_tree_sw_0),
+           ADD_TEST(rt_product_tree_sw_3_split),
+           ADD_TEST(rt_product_tree_rr_1),
+           ADD_TEST(rt_product_tree_sp_7),
+           )
+} // namespace VariedElements
+
 //------------------------------------------------------------------------------
 
 TEST_GROUP("RoundTripCalculator",
@@ -647,6 +823,8 @@ TEST_GROUP("RoundTripCalculator",
            ADD_GROUP(RoundTripEndMatrices_RangeSplit),
            ADD_GROUP(GeneralFuncs),
            ADD_GROUP(InterfacedElements),
+           ADD_GROUP(RealRoundTrip),
+           ADD_GROUP(VariedElements),
            )
 } // namespace RoundTripCalculatorTests
 } // namespace Tests
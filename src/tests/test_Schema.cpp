@@ -268,6 +268,82 @@ TEST_METHOD(set_wavelength__must_raise_event)
 
 //------------------------------------------------------------------------------
 
+TEST_METHOD(recalcCoalescing__must_deliver_single_event)
+{
+    SCHEMA_AND_LISTENER
+    schema.events().setRecalcCoalescing(true);
+    SCHEMA_RESET_STATE
+    listener.reset();
+
+    schema.events().raise(SchemaEvents::RecalRequred, "");
+    schema.wavelength().setValue(Z::Value(10, Z::Units::m()));
+    schema.events().raise(SchemaEvents::RecalRequred, "");
+    ASSERT_IS_TRUE(schema.events().recalcPending())
+    ASSERT_LISTENER(nullptr, EVENT(LambdaChanged), EVENT(Changed))
+
+    schema.events().flushRecalc();
+    ASSERT_IS_FALSE(schema.events().recalcPending())
+    ASSERT_LISTENER(nullptr, EVENT(LambdaChanged), EVENT(Changed), EVENT(RecalRequred))
+    ASSERT_EQ_INT(schema.events().savedRecalcs(), 2)
+
+    // Nothing to deliver anymore
+    schema.events().flushRecalc();
+    ASSERT_LISTENER(nullptr, EVENT(LambdaChanged), EVENT(Changed), EVENT(RecalRequred))
+
+    // Pending event is delivered when coalescing is turned off
+    listener.reset();
+    schema.events().raise(SchemaEvents::RecalRequred, "");
+    ASSERT_LISTENER_NO_EVENTS
+    schema.events().setRecalcCoalescing(false);
+    ASSERT_LISTENER(nullptr, EVENT(RecalRequred))
+    schema.events().raise(SchemaEvents::RecalRequred, "");
+    ASSERT_LISTENER(nullptr, EVENT(RecalRequred), EVENT(RecalRequred))
+    ASSERT_EQ_INT(schema.events().savedRecalcs(), 2)
+}
+
+//------------------------------------------------------------------------------
+
+class NotAffectedListener : public TestSchemaListener
+{
+public:
+    SchemaChanges changes;
+    bool recalcAffectedBy(Schema*, const SchemaChanges& c) override { changes = c; return false; }
+};
+
+TEST_METHOD(recalcRequired__must_be_routed_to_affected_listeners)
+{
+    SCHEMA_AND_LISTENER
+    NotAffectedListener other;
+    schema.registerListener(&other);
+    auto el1 = new TestElement;
+    auto el2 = new TestElement;
+    schema.insertElements({el1, el2}, -1, Arg::RaiseEvents(true));
+    ASSERT_IS_TRUE(schema.events().changes().isEmpty())
+    ASSERT_IS_TRUE(other.events.contains(SchemaEvents::RecalRequred))
+
+    listener.reset();
+    other.reset();
+    schema.events().raise(SchemaEvents::ElemChanged, el2, "");
+    ASSERT_IS_TRUE(schema.events().changes().elements == Elements({el2}))
+    schema.events().raise(SchemaEvents::RecalRequred, "");
+    ASSERT_IS_TRUE(schema.events().changes().isEmpty())
+    ASSERT_LISTENER(el2, EVENT(ElemChanged), EVENT(Changed), EVENT(RecalRequred))
+    ASSERT_IS_FALSE(other.events.contains(SchemaEvents::RecalRequred))
+    ASSERT_IS_FALSE(other.changes.all)
+    ASSERT_IS_TRUE(other.changes.elements == Elements({el2}))
+    ASSERT_EQ_INT(schema.events().skippedRecalcs(), 1)
+
+    // Recalculation without known reason goes to everyone
+    other.reset();
+    schema.events().raise(SchemaEvents::RecalRequred, "");
+    ASSERT_IS_TRUE(other.events.contains(SchemaEvents::RecalRequred))
+    ASSERT_EQ_INT(schema.events().skippedRecalcs(), 1)
+
+    schema.unregisterListener(&other);
+}
+
+//------------------------------------------------------------------------------
+
 TEST_METHOD(Element_RequiresWavelength__must_be_respected)
 {
     Schema schema;
@@ -585,6 +661,209 @@ TEST_METHOD(ElementInterface__must_be_unlinked_after_deletion_of_neighbour)
 
 //------------------------------------------------------------------------------
 
+namespace {
+DECLARE_ELEMENT(TestDrivenElement, Element)
+    TestDrivenElement() { addParam(param); }
+    Z::Parameter *param = new Z::Parameter(Z::Dims::none(), "p");
+    QVector<double> calculatedValues;
+    void calcMatrixInternal() override { calculatedValues << param->value().value(); }
+DECLARE_ELEMENT_END
+
+class TestParamValues : public Z::ParameterListener
+{
+public:
+    QVector<double> values;
+    void parameterChanged(Z::ParameterBase *p) override
+    {
+        values << dynamic_cast<Z::Parameter*>(p)->value().value();
+    }
+};
+}
+
+TEST_METHOD(paramDrivers__must_be_evaluated_once_in_order)
+{
+    SCHEMA_AND_LISTENER
+
+    // a -> b = a*2 -> d = b+c -> elem.param
+    //   \-> c = a+1 -/
+    auto a = new Z::Parameter(Z::Dims::none(), "a");
+    auto b = new Z::Parameter(Z::Dims::none(), "b");
+    auto c = new Z::Parameter(Z::Dims::none(), "c");
+    auto d = new Z::Parameter(Z::Dims::none(), "d");
+    for (auto p : {a, b, c, d})
+    {
+        p->setValue(Z::Value(1, Z::Units::none()));
+        schema.customParams()->append(p);
+    }
+    auto addFormula = [&schema](Z::Parameter* target, const QString& code, const Z::Parameters& deps)
+    {
+        auto formula = new Z::Formula(target);
+        for (auto dep : deps)
+            formula->addDep(dep);
+        formula->setCode(code);
+        schema.formulas()->put(formula);
+        formula->calculate();
+    };
+    addFormula(b, "a * 2", {a});
+    addFormula(c, "a + 1", {a});
+    addFormula(d, "b + c", {b, c});
+    ASSERT_EQ_DBL(d->value().value(), 4)
+
+    auto elem = new TestDrivenElement;
+    schema.insertElements({elem}, -1, Arg::RaiseEvents(false));
+    schema.paramLinks()->append(new Z::ParamLink(d, elem->param));
+    ASSERT_EQ_DBL(elem->param->value().value(), 4)
+
+    TestParamValues dValues;
+    d->addListener(&dValues);
+    elem->calculatedValues.clear();
+    SCHEMA_RESET_STATE
+    listener.reset();
+
+    a->setValue(Z::Value(2, Z::Units::none()));
+    ASSERT_EQ_DBL(b->value().value(), 4)
+    ASSERT_EQ_DBL(c->value().value(), 3)
+    ASSERT_EQ_DBL(d->value().value(), 7)
+    ASSERT_EQ_DBL(elem->param->value().value(), 7)
+
+    // Formula for `d` must be calculated only when both `b` and `c` are updated
+    ASSERT_EQ_INT(dValues.values.size(), 1)
+    ASSERT_EQ_DBL(dValues.values.first(), 7)
+
+    // Element must be recalculated and reported only once
+    ASSERT_EQ_INT(elem->calculatedValues.size(), 1)
+    ASSERT_EQ_DBL(elem->calculatedValues.first(), 7)
+    ASSERT_LISTENER(elem, EVENT(ElemChanged), EVENT(Changed))
+
+    // The next change must be propagated too
+    a->setValue(Z::Value(3, Z::Units::none()));
+    ASSERT_EQ_DBL(d->value().value(), 10)
+    ASSERT_EQ_INT(dValues.values.size(), 2)
+    ASSERT_EQ_INT(elem->calculatedValues.size(), 2)
+
+    d->removeListener(&dValues);
+}
+
+TEST_METHOD(paramDrivers__must_propagate_each_change)
+{
+    SCHEMA_AND_LISTENER
+
+    auto a = new Z::Parameter(Z::Dims::none(), "a");
+    auto b = new Z::Parameter(Z::Dims::none(), "b");
+    for (auto p : {a, b})
+    {
+        p->setValue(Z::Value(1, Z::Units::none()));
+        schema.customParams()->append(p);
+    }
+
+    // Links added in any way must be driven by the schema
+    auto elem = new TestDrivenElement;
+    schema.insertElements({elem}, -1, Arg::RaiseEvents(false));
+    *schema.paramLinks() << new Z::ParamLink(a, elem->param);
+
+    // The formula is known to the schema but doesn't listen to its source,
+    // so the number of drivers notified differs from the number of drivers of the source
+    auto formula = new Z::Formula(b);
+    formula->addDep(a);
+    formula->setCode("a * 2");
+    schema.formulas()->put(formula);
+    a->removeListener(formula);
+
+    TestParamValues elemValues;
+    elem->param->addListener(&elemValues);
+
+    for (double value : {2, 3, 4})
+    {
+        a->setValue(Z::Value(value, Z::Units::none()));
+        ASSERT_EQ_DBL(elem->param->value().value(), value)
+        ASSERT_EQ_DBL(b->value().value(), value * 2)
+    }
+    ASSERT_EQ_INT(elemValues.values.size(), 3)
+
+    elem->param->removeListener(&elemValues);
+}
+
+TEST_METHOD(transaction__must_defer_calculations_and_events)
+{
+    SCHEMA_AND_LISTENER
+
+    auto a = new Z::Parameter(Z::Dims::none(), "a");
+    a->setValue(Z::Value(1, Z::Units::none()));
+    schema.customParams()->append(a);
+
+    auto elem = new TestDrivenElement;
+    schema.insertElements({elem}, -1, Arg::RaiseEvents(false));
+    schema.paramLinks()->append(new Z::ParamLink(a, elem->param));
+    elem->calculatedValues.clear();
+    SCHEMA_RESET_STATE
+    listener.reset();
+
+    schema.beginTransaction();
+    schema.beginTransaction();
+    a->setValue(Z::Value(2, Z::Units::none()));
+    a->setValue(Z::Value(3, Z::Units::none()));
+    elem->setLabel("E1");
+    schema.events().raise(SchemaEvents::RecalRequred, "test");
+    schema.events().raise(SchemaEvents::RecalRequred, "test");
+
+    // Nested commit must not apply changes
+    schema.commitTransaction();
+    ASSERT_IS_TRUE(schema.inTransaction())
+    ASSERT_EQ_DBL(elem->param->value().value(), 1)
+    ASSERT_IS_TRUE(elem->calculatedValues.isEmpty())
+    ASSERT_IS_TRUE(listener.events.isEmpty())
+
+    // Outermost commit must evaluate links, recalculate matrices, and raise events only once
+    schema.commitTransaction();
+    ASSERT_IS_FALSE(schema.inTransaction())
+    ASSERT_EQ_DBL(elem->param->value().value(), 3)
+    ASSERT_EQ_INT(elem->calculatedValues.size(), 1)
+    ASSERT_EQ_DBL(elem->calculatedValues.first(), 3)
+    ASSERT_LISTENER(elem, EVENT(ElemChanged), EVENT(Changed), EVENT(RecalRequred))
+
+    // Element deleted in transaction must not be reported as changed
+    listener.reset();
+    {
+        SchemaTransaction transaction(&schema);
+        elem->setLabel("E2");
+        schema.deleteElements({elem}, Arg::RaiseEvents(true), Arg::FreeElem(false));
+    }
+    ASSERT_LISTENER(elem, EVENT(ElemDeleting), EVENT(ElemDeleted), EVENT(Changed), EVENT(RecalRequred))
+    delete elem;
+}
+
+TEST_METHOD(transaction__must_forget_changes_of_deleted_objects)
+{
+    SCHEMA_AND_LISTENER
+
+    auto a = new Z::Parameter(Z::Dims::none(), "a");
+    a->setValue(Z::Value(1, Z::Units::none()));
+    schema.customParams()->append(a);
+
+    auto elem = new TestDrivenElement;
+    schema.insertElements({elem}, -1, Arg::RaiseEvents(false));
+    schema.paramLinks()->append(new Z::ParamLink(a, elem->param));
+    SCHEMA_RESET_STATE
+    listener.reset();
+
+    // Objects are removed silently and freed before commit,
+    // so queued events and changed sources must not refer to them anymore
+    {
+        SchemaTransaction transaction(&schema);
+        elem->setLabel("E1");
+        a->setValue(Z::Value(2, Z::Units::none()));
+        schema.events().raise(SchemaEvents::CustomParamChanged, a, "test");
+        schema.deleteElements({elem}, Arg::RaiseEvents(false), Arg::FreeElem(true));
+        schema.removeCustomParam(a);
+        delete a;
+    }
+    ASSERT_IS_FALSE(schema.inTransaction())
+    ASSERT_IS_TRUE(listener.events.isEmpty())
+    ASSERT_EQ_INT(schema.paramLinks()->size(), 0)
+}
+
+//------------------------------------------------------------------------------
+
 TEST_METHOD(activePump)
 {
     auto p1 = PumpMode_Waist::instance()->makePump();
@@ -614,6 +893,8 @@ TEST_GROUP("Schema",
     ADD_TEST(generateLabel__next_elem),
     ADD_TEST(raise_all_events),
     ADD_TEST(set_wavelength__must_raise_event),
+    ADD_TEST(recalcCoalescing__must_deliver_single_event),
+    ADD_TEST(recalcRequired__must_be_routed_to_affected_listeners),
     ADD_TEST(Element_RequiresWavelength__must_be_respected),
     ADD_TEST(enabledCount),
     ADD_TEST(elementById),
@@ -633,6 +914,10 @@ TEST_GROUP("Schema",
     ADD_TEST(ElementInterface__must_be_linked_to_neighbours),
     ADD_TEST(ElementInterface__must_be_unlinked_after_deletion_of_itself),
     ADD_TEST(ElementInterface__must_be_unlinked_after_deletion_of_neighbour),
+    ADD_TEST(paramDrivers__must_be_evaluated_once_in_order),
+    ADD_TEST(paramDrivers__must_propagate_each_change),
+    ADD_TEST(transaction__must_defer_calculations_and_events),
+    ADD_TEST(transaction__must_forget_changes_of_deleted_objects),
     ADD_TEST(activePump),
 )
 
@@ -193,6 +193,57 @@ TEST_CASE(must_respect_medium_ior__sp__lens_in_middle, must_respect_medium_ior__
 TEST_CASE(must_respect_medium_ior__rr__flat_in_middle, must_respect_medium_ior__sp_rr__elem_in_middle, "calc_beamdata_elems_and_media__3_1.rez", TripType::RR)
 TEST_CASE(must_respect_medium_ior__rr__lens_in_middle, must_respect_medium_ior__sp_rr__elem_in_middle, "calc_beamdata_elems_and_media__3_2.rez", TripType::RR)
 
+// Values are calculated from differently grouped matrix products, so only near equality is expected
+static bool isSameValue(double v1, double v2)
+{
+    if (std::isnan(v1) || std::isnan(v2))
+        return std::isnan(v1) && std::isnan(v2);
+    // Front radius near a waist is very sensitive to rounding, consider it infinite the same
+    if (qAbs(v1) > 1e6 && qAbs(v2) > 1e6)
+        return true;
+    return qAbs(v1 - v2) <= 1e-9 * qMax(qAbs(v1), qAbs(v2)) + 1e-15;
+}
+
+TEST_CASE_METHOD(propagation_must_give_same_as_round_trips, QString fileName, TripType tripType)
+{
+    READ_TEST_FILE(fileName)
+    schema.setTripType(tripType);
+    BeamParamsAtElemsFunction func(&schema);
+    func.calcMediumEnds = true;
+    func.calcEmptySpaces = true;
+
+    func.propagate = false;
+    func.calculate();
+    ASSERT_IS_TRUE(func.ok())
+    auto expected = func.results();
+
+    func.propagate = true;
+    func.calculate();
+    ASSERT_IS_TRUE(func.ok())
+    auto results = func.results();
+
+    ASSERT_EQ_INT(results.size(), expected.size())
+    for (int i = 0; i < results.size(); i++)
+    {
+        TEST_LOG(results.at(i).str())
+        TEST_LOG(expected.at(i).str())
+        ASSERT_EQ_PTR(results.at(i).element, expected.at(i).element)
+        ASSERT_IS_TRUE(results.at(i).position == expected.at(i).position)
+        ASSERT_EQ_INT(results.at(i).values.size(), expected.at(i).values.size())
+        for (int j = 0; j < results.at(i).values.size(); j++)
+        {
+            ASSERT_IS_TRUE(isSameValue(results.at(i).values.at(j).T, expected.at(i).values.at(j).T))
+            ASSERT_IS_TRUE(isSameValue(results.at(i).values.at(j).S, expected.at(i).values.at(j).S))
+        }
+    }
+}
+TEST_CASE(propagation__interfaces_sw, propagation_must_give_same_as_round_trips, "calc_beamdata_interfaces.rez", TripType::SW)
+TEST_CASE(propagation__interfaces_sp, propagation_must_give_same_as_round_trips, "calc_beamdata_interfaces.rez", TripType::SP)
+TEST_CASE(propagation__interfaces_rr, propagation_must_give_same_as_round_trips, "calc_beamdata_interfaces.rez", TripType::RR)
+TEST_CASE(propagation__lens_in_middle_sw, propagation_must_give_same_as_round_trips, "calc_beamdata_elems_and_media__3_2.rez", TripType::SW)
+TEST_CASE(propagation__lens_in_middle_sp, propagation_must_give_same_as_round_trips, "calc_beamdata_elems_and_media__3_2.rez", TripType::SP)
+TEST_CASE(propagation__lens_in_middle_rr, propagation_must_give_same_as_round_trips, "calc_beamdata_elems_and_media__3_2.rez", TripType::RR)
+
 TEST_GROUP("BeamParamsAtElemsFunction",
            ADD_TEST(interfaces_sw),
            ADD_TEST(interfaces_sp),
@@ -213,6 +264,12 @@ TEST_GROUP("BeamParamsAtElemsFunction",
            ADD_TEST(must_respect_medium_ior__sp__lens_in_middle),
            ADD_TEST(must_respect_medium_ior__rr__flat_in_middle),
            ADD_TEST(must_respect_medium_ior__rr__lens_in_middle),
+           ADD_TEST(propagation__interfaces_sw),
+           ADD_TEST(propagation__interfaces_sp),
+           ADD_TEST(propagation__interfaces_rr),
+           ADD_TEST(propagation__lens_in_middle_sw),
+           ADD_TEST(propagation__lens_in_middle_sp),
+           ADD_TEST(propagation__lens_in_middle_rr),
            )
 }
 